@@ -0,0 +1,167 @@
+/* Measures the phase 1 hot paths, one operation at a time.
+ *
+ * fork_join: forks a priority 5 child that quits at once, then joins it
+ * pingpong:  two priority 3 processes take turns, each unblock_proc()s
+ *            the other and block_me()s, one round trip is two switches
+ * zap:       zaps a lower priority child that spins until it is zapped,
+ *            from the zap call until zap returns
+ *
+ * Prints one "key=value" line per operation: operations per second of
+ * wall time, then p50/p90/p99/max latency in sys_clock() microseconds
+ * and in wall clock nanoseconds.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <usloss.h>
+#include <phase1.h>
+
+#define ITERATIONS      2000
+#define PINGPONG_STATUS 20
+
+int quitter(char *);
+int ponger(char *);
+int spinner(char *);
+long now_ns(void);
+void report(char *op, int *sim_us, long *wall_ns, long total_ns);
+int compare_ints(const void *a, const void *b);
+int compare_longs(const void *a, const void *b);
+
+int sim_us[ITERATIONS];
+long wall_ns[ITERATIONS];
+int ping_pid;
+int pong_done;
+
+int start1(char *arg)
+{
+  int i, status, pid, sim_start;
+  long start, wall_start, total;
+
+  /* fork_join */
+  total = now_ns();
+  for (i = 0; i < ITERATIONS; i++) {
+    sim_start = sys_clock();
+    wall_start = now_ns();
+    fork1("quitter", quitter, NULL, USLOSS_MIN_STACK, 5);
+    join(&status);
+    wall_ns[i] = now_ns() - wall_start;
+    sim_us[i] = sys_clock() - sim_start;
+  }
+  report("fork_join", sim_us, wall_ns, now_ns() - total);
+
+  /* pingpong, run from a priority 3 process so the two are equals */
+  fork1("pinger", ponger, "ping", USLOSS_MIN_STACK, 3);
+  join(&status);
+
+  /* zap */
+  start = now_ns();
+  total = 0;
+  for (i = 0; i < ITERATIONS; i++) {
+    pid = fork1("spinner", spinner, NULL, USLOSS_MIN_STACK, 5);
+    sim_start = sys_clock();
+    wall_start = now_ns();
+    zap(pid);
+    wall_ns[i] = now_ns() - wall_start;
+    sim_us[i] = sys_clock() - sim_start;
+    total += wall_ns[i];
+    join(&status);
+  }
+  report("zap", sim_us, wall_ns, total);
+  printf("bench=kernel op=zap_cycle ops_per_sec=%.0f\n",
+         ITERATIONS * 1e9 / (now_ns() - start));
+
+  quit(0);
+  return 0; /* so gcc will not complain about its absence... */
+}
+
+int quitter(char *arg)
+{
+  quit(0);
+  return 0;
+}
+
+/* The "ping" side forks the "pong" side and times each round trip */
+int ponger(char *arg)
+{
+  int i, status, pong_pid, sim_start;
+  long wall_start, total;
+
+  if (arg[1] == 'o') {
+    /* pong: ping back, then block until pinged */
+    for (;;) {
+      unblock_proc(ping_pid);
+      block_me(PINGPONG_STATUS);
+      if (pong_done)
+        break;
+    }
+    quit(0);
+  }
+
+  ping_pid = getpid();
+  pong_pid = fork1("ponger", ponger, "pong", USLOSS_MIN_STACK, 3);
+
+  /* pong wakes us on its way to its first block_me */
+  block_me(PINGPONG_STATUS);
+
+  total = now_ns();
+  for (i = 0; i < ITERATIONS; i++) {
+    sim_start = sys_clock();
+    wall_start = now_ns();
+    unblock_proc(pong_pid);
+    block_me(PINGPONG_STATUS);
+    wall_ns[i] = now_ns() - wall_start;
+    sim_us[i] = sys_clock() - sim_start;
+  }
+  report("pingpong", sim_us, wall_ns, now_ns() - total);
+
+  pong_done = 1;
+  unblock_proc(pong_pid);
+  join(&status);
+  quit(0);
+  return 0;
+}
+
+/* Spins until zapped */
+int spinner(char *arg)
+{
+  while (!is_zapped())
+    ;
+  quit(0);
+  return 0;
+}
+
+long now_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+/* Prints the rate and latency percentiles of one operation */
+void report(char *op, int *sim_us, long *wall_ns, long total_ns)
+{
+  qsort(sim_us, ITERATIONS, sizeof(int), compare_ints);
+  qsort(wall_ns, ITERATIONS, sizeof(long), compare_longs);
+  printf("bench=kernel op=%s iters=%d ops_per_sec=%.0f "
+         "sim_p50_us=%d sim_p90_us=%d sim_p99_us=%d sim_max_us=%d "
+         "wall_p50_ns=%ld wall_p90_ns=%ld wall_p99_ns=%ld wall_max_ns=%ld\n",
+         op, ITERATIONS, ITERATIONS * 1e9 / total_ns,
+         sim_us[ITERATIONS / 2], sim_us[ITERATIONS * 90 / 100],
+         sim_us[ITERATIONS * 99 / 100], sim_us[ITERATIONS - 1],
+         wall_ns[ITERATIONS / 2], wall_ns[ITERATIONS * 90 / 100],
+         wall_ns[ITERATIONS * 99 / 100], wall_ns[ITERATIONS - 1]);
+}
+
+int compare_ints(const void *a, const void *b)
+{
+  return *(const int *) a - *(const int *) b;
+}
+
+int compare_longs(const void *a, const void *b)
+{
+  long x = *(const long *) a, y = *(const long *) b;
+
+  return (x > y) - (x < y);
+}
@@ -0,0 +1,139 @@
+/* Measures how long an I/O bound process waits to run after its I/O
+ * completes while CPU bound processes of the same priority are busy,
+ * under the scheduling policy chosen with PHASE1_SCHED. Run once as is
+ * and once with PHASE1_SCHED=mlfq.
+ *
+ * The workload is shaped like the phase 4 terminal and disk tests: client
+ * processes block_me() on a request and do a short burst of work when it
+ * completes. The phase 4 drivers can't run here, so the clock interrupt
+ * plays the device: each tick completes the request of every waiting
+ * client, from interrupt context, the way the phase 2 device handlers
+ * wake waitdevice().
+ *
+ * response: p50/p90/p99/max from request completion to the client running
+ * summary:  client bursts done and the CPU share of the CPU bound processes
+ *
+ * Prints "key=value" lines, times are sys_clock() microseconds.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <usloss.h>
+#include <phase1.h>
+
+#define WINDOW          10000000
+#define NUM_HOGS        2
+#define NUM_CLIENTS     2
+#define PRIORITY        3
+#define IO_STATUS       20
+#define BURST           2000
+#define MAX_SAMPLES     4096
+
+int hog(char *);
+int client(char *);
+void device_clock(int dev, void *arg);
+int compare_ints(const void *a, const void *b);
+
+void (*saved_clock)(int dev, void *arg);
+int start_time;
+int client_pid[NUM_CLIENTS];
+int client_waiting[NUM_CLIENTS];
+int done_time[NUM_CLIENTS];
+int response[MAX_SAMPLES];
+int num_samples;
+int bursts;
+int clients_left = NUM_CLIENTS;
+int hog_cpu;
+
+int start1(char *arg)
+{
+  int i, status;
+  char buf[10];
+  char *policy[] = {"priority", "stride", "mlfq"};
+
+  saved_clock = int_vec[CLOCK_DEV];
+  int_vec[CLOCK_DEV] = device_clock;
+
+  start_time = sys_clock();
+  for (i = 0; i < NUM_HOGS; i++)
+    fork1("hog", hog, NULL, USLOSS_MIN_STACK, PRIORITY);
+  for (i = 0; i < NUM_CLIENTS; i++) {
+    sprintf(buf, "%d", i);
+    client_pid[i] = fork1("client", client, buf, USLOSS_MIN_STACK, PRIORITY);
+  }
+  for (i = 0; i < NUM_HOGS + NUM_CLIENTS; i++)
+    join(&status);
+
+  qsort(response, num_samples, sizeof(int), compare_ints);
+  printf("bench=mlfq policy=%s clients=%d hogs=%d samples=%d resp_p50_us=%d "
+         "resp_p90_us=%d resp_p99_us=%d resp_max_us=%d\n",
+         policy[sched_policy], NUM_CLIENTS, NUM_HOGS, num_samples,
+         response[num_samples / 2], response[num_samples * 90 / 100],
+         response[num_samples * 99 / 100], response[num_samples - 1]);
+  printf("bench=mlfq policy=%s summary bursts=%d hog_share=%.3f\n",
+         policy[sched_policy], bursts,
+         (double) hog_cpu / (NUM_HOGS * (double) (sys_clock() - start_time)));
+
+  int_vec[CLOCK_DEV] = saved_clock;
+  quit(0);
+  return 0; /* so gcc will not complain about its absence... */
+}
+
+/* Spins until the window closes, and the clients are done so there is
+ * always a process running when their requests complete */
+int hog(char *arg)
+{
+  proc_usage usage;
+
+  while (sys_clock() - start_time < WINDOW || clients_left > 0)
+    ;
+  get_proc_usage(getpid(), &usage);
+  hog_cpu += usage.cpu_time;
+  quit(0);
+  return 0;
+}
+
+/* Waits for a request, then works on it for BURST */
+int client(char *arg)
+{
+  int me = atoi(arg);
+  int start;
+
+  while (sys_clock() - start_time < WINDOW) {
+    client_waiting[me] = 1;
+    block_me(IO_STATUS);
+    if (num_samples < MAX_SAMPLES)
+      response[num_samples++] = sys_clock() - done_time[me];
+
+    start = sys_clock();
+    while (sys_clock() - start < BURST)
+      ;
+    bursts++;
+  }
+  clients_left--;
+  quit(0);
+  return 0;
+}
+
+/* Completes the request of every waiting client, then does the usual
+ * clock work. A client that has not reached block_me yet is completed
+ * on the next tick. */
+void device_clock(int dev, void *arg)
+{
+  int i;
+
+  for (i = 0; i < NUM_CLIENTS; i++) {
+    if (client_waiting[i]) {
+      done_time[i] = sys_clock();
+      if (unblock_proc(client_pid[i]) == 0)
+        client_waiting[i] = 0;
+    }
+  }
+  saved_clock(dev, arg);
+  resched();
+}
+
+int compare_ints(const void *a, const void *b)
+{
+  return *(const int *) a - *(const int *) b;
+}
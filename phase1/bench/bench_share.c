@@ -0,0 +1,94 @@
+/* Compares how the CPU is shared under the scheduling policy chosen with
+ * PHASE1_SCHED. Run once as is and once with PHASE1_SCHED=stride.
+ *
+ * One CPU bound worker per priority spins for WINDOW microseconds. Each
+ * level gets a short time slice so the window holds enough slices for
+ * the shares to show.
+ *
+ * share:    per priority, the CPU time a worker got, its share of the
+ *           total, the SCHED_TICKETS share it is due and how long it
+ *           waited before first running
+ * summary:  Jain's fairness index over share/due (1.0 is exactly fair),
+ *           the loop iterations per millisecond all workers got done,
+ *           and the number of context switches
+ *
+ * Prints "key=value" lines, times are sys_clock() microseconds.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <usloss.h>
+#include <phase1.h>
+
+#define WINDOW  10000000
+#define SLICE   10000
+#define WORKERS 5       /* one for each of priorities 1 to 5 */
+
+int worker(char *);
+
+int start_time;
+int cpu_us[WORKERS];
+int first_run_us[WORKERS];
+long loops[WORKERS];
+
+int start1(char *arg)
+{
+  int i, status, tickets, switches, no_switches, switch_start;
+  long total_loops = 0;
+  double total_cpu = 0, sum = 0, sum_squares = 0;
+  char buf[10];
+
+  for (i = 0; i < WORKERS; i++)
+    set_time_slice(HIGHEST_PRIORITY + i, SLICE);
+
+  read_switch_counts(&switch_start, &no_switches);
+  start_time = sys_clock();
+  for (i = 0; i < WORKERS; i++) {
+    sprintf(buf, "%d", i);
+    fork1("worker", worker, buf, USLOSS_MIN_STACK, HIGHEST_PRIORITY + i);
+  }
+  for (i = 0; i < WORKERS; i++)
+    join(&status);
+  read_switch_counts(&switches, &no_switches);
+
+  tickets = 0;
+  for (i = 0; i < WORKERS; i++) {
+    tickets += SCHED_TICKETS(HIGHEST_PRIORITY + i);
+    total_cpu += cpu_us[i];
+    total_loops += loops[i];
+  }
+
+  for (i = 0; i < WORKERS; i++) {
+    double share = cpu_us[i] / total_cpu;
+    double due = (double) SCHED_TICKETS(HIGHEST_PRIORITY + i) / tickets;
+
+    printf("bench=share policy=%s priority=%d cpu_us=%d share=%.3f due=%.3f "
+           "first_run_us=%d\n", sched_policy == SCHED_STRIDE ? "stride" : "priority",
+           HIGHEST_PRIORITY + i, cpu_us[i], share, due, first_run_us[i]);
+    sum += share / due;
+    sum_squares += (share / due) * (share / due);
+  }
+  printf("bench=share policy=%s summary fairness=%.3f loops_per_ms=%.0f "
+         "switches=%d\n", sched_policy == SCHED_STRIDE ? "stride" : "priority",
+         sum * sum / (WORKERS * sum_squares),
+         total_loops / ((sys_clock() - start_time) / 1000.0),
+         switches - switch_start);
+
+  quit(0);
+  return 0; /* so gcc will not complain about its absence... */
+}
+
+/* Spins until the window closes, recording the CPU time it got */
+int worker(char *arg)
+{
+  int me = atoi(arg);
+  proc_usage usage;
+
+  first_run_us[me] = sys_clock() - start_time;
+  while (sys_clock() - start_time < WINDOW)
+    loops[me]++;
+  get_proc_usage(getpid(), &usage);
+  cpu_us[me] = usage.cpu_time;
+  quit(0);
+  return 0;
+}
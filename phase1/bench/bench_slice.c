@@ -0,0 +1,101 @@
+/* Compares the default scheduler with the tickless, per-priority time
+ * slice mode.
+ *
+ * overhead: one CPU bound process runs alone at priority 3, counts the
+ *           dispatcher calls and interrupt time it was charged.
+ * response: NUM_SPINNERS CPU bound processes are forked together at
+ *           priority 4, measures how long each waits before first running.
+ *
+ * Prints one "key=value" line per scenario and mode, times are sys_clock()
+ * microseconds.
+ */
+
+#include <stdio.h>
+#include <usloss.h>
+#include <stdlib.h>
+#include <phase1.h>
+
+#define ALONE_SPIN      1000000
+#define NUM_SPINNERS    4
+#define SPINNER_SPIN    200000
+#define TICKLESS_SLICE  40000
+
+int spin(char *);
+int spinner(char *);
+void run_mode(char *mode);
+
+int fork_time;
+int response[NUM_SPINNERS];
+
+int start1(char *arg)
+{
+  run_mode("default");
+
+  set_tickless(1);
+  set_time_slice(3, 4 * TICKLESS_SLICE);
+  set_time_slice(4, TICKLESS_SLICE);
+  run_mode("tickless");
+
+  quit(0);
+  return 0; /* so gcc will not complain about its absence... */
+}
+
+void run_mode(char *mode)
+{
+  int status, i;
+  int switches, no_switches, dispatches;
+  int total, max;
+  char buf[10];
+
+  read_switch_counts(&switches, &no_switches);
+  dispatches = switches + no_switches;
+  fork1("spin", spin, NULL, USLOSS_MIN_STACK, 3);
+  join(&status);
+  read_switch_counts(&switches, &no_switches);
+  dispatches = switches + no_switches - dispatches;
+  printf("bench=slice scenario=overhead mode=%s run_us=%d dispatches=%d "
+         "int_us=%d\n", mode, ALONE_SPIN, dispatches, status);
+
+  fork_time = sys_clock();
+  for (i = 0; i < NUM_SPINNERS; i++) {
+    sprintf(buf, "%d", i);
+    fork1("spinner", spinner, buf, USLOSS_MIN_STACK, 4);
+  }
+  for (i = 0; i < NUM_SPINNERS; i++)
+    join(&status);
+
+  total = 0;
+  max = 0;
+  for (i = 0; i < NUM_SPINNERS; i++) {
+    total += response[i];
+    if (response[i] > max)
+      max = response[i];
+  }
+  printf("bench=slice scenario=response mode=%s procs=%d avg_us=%d "
+         "max_us=%d\n", mode, NUM_SPINNERS, total / NUM_SPINNERS, max);
+}
+
+/* Runs alone for ALONE_SPIN, quits with the interrupt time it was charged */
+int spin(char *arg)
+{
+  int start = sys_clock();
+  proc_usage usage;
+
+  while (sys_clock() - start < ALONE_SPIN)
+    ;
+  get_proc_usage(getpid(), &usage);
+  quit(usage.int_time);
+  return 0;
+}
+
+/* Records its response time, then competes for SPINNER_SPIN */
+int spinner(char *arg)
+{
+  int start = sys_clock();
+
+  response[atoi(arg)] = start - fork_time;
+  while (sys_clock() - start < SPINNER_SPIN)
+    ;
+  quit(0);
+  return 0;
+}
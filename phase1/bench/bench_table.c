@@ -0,0 +1,141 @@
+/* Measures fork, dispatch and process table scans over a full table.
+ *
+ * fork:     fills every free slot with a priority 5 child, wall time per fork1
+ * dispatch: joins every child, each child runs and quits, so every join
+ *           costs two dispatches
+ * scan:     reads status and priority of every slot, the access pattern of
+ *           dump_processes and the wait-for graph, once over ProcTable and
+ *           once over a copy laid out with the cold fields inline, as
+ *           proc_struct was before they were split out. The caches are
+ *           flushed before each round so every scan starts cold.
+ *
+ * Run with PHASE1_MAXPROC set for a large table. Prints "key=value" lines,
+ * times are wall clock nanoseconds.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <usloss.h>
+#include <phase1.h>
+#include "kernel.h"
+
+#define SCAN_ROUNDS 20
+#define FLUSH_BYTES (64 * 1024 * 1024)
+
+/* A process table entry with its cold fields inline */
+typedef struct fat_proc {
+  proc_struct hot;
+  proc_cold   cold;
+} fat_proc;
+
+extern proc_struct *ProcTable;
+
+int child(char *);
+long now_ns(void);
+long scan_hot(long *ns);
+long scan_fat(fat_proc *table, long *ns);
+void flush_caches(void);
+
+char *flush_buf;
+
+int start1(char *arg)
+{
+  int i, status, forked;
+  long start, fork_ns, join_ns, hot_ns, fat_ns, sum;
+  fat_proc *fat;
+
+  start = now_ns();
+  for (forked = 0; fork1("child", child, NULL, USLOSS_MIN_STACK, 5) > 0; forked++)
+    ;
+  fork_ns = now_ns() - start;
+
+  /* Scan with the table full */
+  fat = calloc(num_proc_slots, sizeof(fat_proc));
+  for (i = 0; i < num_proc_slots; i++)
+    fat[i].hot = ProcTable[i];
+
+  flush_buf = malloc(FLUSH_BYTES);
+  hot_ns = 0;
+  fat_ns = 0;
+  sum = 0;
+  for (i = 0; i < SCAN_ROUNDS; i++) {
+    flush_caches();
+    sum += scan_hot(&hot_ns);
+    flush_caches();
+    sum -= scan_fat(fat, &fat_ns);
+  }
+
+  start = now_ns();
+  for (i = 0; i < forked; i++)
+    join(&status);
+  join_ns = now_ns() - start;
+
+  printf("bench=table slots=%d procs=%d\n", num_proc_slots, forked);
+  printf("bench=table op=fork ns_per_op=%ld\n", fork_ns / forked);
+  printf("bench=table op=join_dispatch ns_per_op=%ld\n", join_ns / forked);
+  printf("bench=table op=scan layout=split entry_bytes=%d lines_per_entry=%d "
+         "ns_per_slot=%.2f\n", (int) sizeof(proc_struct),
+         (int) ((sizeof(proc_struct) + 63) / 64),
+         (double) hot_ns / SCAN_ROUNDS / num_proc_slots);
+  printf("bench=table op=scan layout=inline entry_bytes=%d lines_per_entry=%d "
+         "ns_per_slot=%.2f\n", (int) sizeof(fat_proc),
+         (int) ((sizeof(fat_proc) + 63) / 64),
+         (double) fat_ns / SCAN_ROUNDS / num_proc_slots);
+  if (sum != 0)
+    printf("bench=table error=scan_mismatch\n");
+
+  free(fat);
+  free(flush_buf);
+  quit(0);
+  return 0; /* so gcc will not complain about its absence... */
+}
+
+int child(char *arg)
+{
+  quit(0);
+  return 0;
+}
+
+long now_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+/* Evicts the process table from the caches */
+void flush_caches(void)
+{
+  int i;
+
+  for (i = 0; i < FLUSH_BYTES; i += 64)
+    flush_buf[i]++;
+}
+
+/* Scans ProcTable once, adding the time taken to *ns */
+long scan_hot(long *ns)
+{
+  long sum = 0, start = now_ns();
+  int i;
+
+  for (i = 0; i < num_proc_slots; i++)
+    if (ProcTable[i].status != EMPTY)
+      sum += ProcTable[i].priority;
+  *ns += now_ns() - start;
+  return sum;
+}
+
+/* Scans the inline copy once, adding the time taken to *ns */
+long scan_fat(fat_proc *table, long *ns)
+{
+  long sum = 0, start = now_ns();
+  int i;
+
+  for (i = 0; i < num_proc_slots; i++)
+    if (table[i].hot.status != EMPTY)
+      sum += table[i].hot.priority;
+  *ns += now_ns() - start;
+  return sum;
+}
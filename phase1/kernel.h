@@ -8,6 +8,18 @@
 #define SENTINELPRIORITY LOWEST_PRIORITY
 #define TIME_SLICE 80000
 
+/* Stride of a process with one ticket under SCHED_STRIDE */
+#define STRIDE1 (1 << 20)
+
+/* Microseconds between SCHED_MLFQ returns of every process to its priority */
+#define MLFQ_AGING 1000000
+
+/* Stacks of up to STACK_CLASSES * USLOSS_MIN_STACK bytes are pooled */
+#define STACK_CLASSES 32
+
+/* Process table slots per word of the slot bitmap */
+#define SLOT_BITS ((int) (8 * sizeof(unsigned long)))
+
 /* Process statuses */
 #define READY 1
 #define RUNNING 2
@@ -19,28 +31,70 @@
 
 typedef struct proc_struct proc_struct;
 typedef struct proc_struct * proc_ptr;
+typedef struct proc_cold proc_cold;
+typedef struct ready_queue ready_queue;
+typedef struct stack_pool stack_pool;
 
 struct proc_struct {
    proc_ptr         next_proc_ptr;
+   proc_ptr         prev_proc_ptr;
    proc_ptr         child_proc_ptr;
+   proc_ptr         child_tail_ptr;    /* last child, fork1 appends here */
    proc_ptr         next_sibling_ptr;
+   proc_ptr         prev_sibling_ptr;
    proc_ptr         parent_ptr;
    proc_ptr         quit_child_ptr;
+   proc_ptr         quit_child_tail;   /* last quit child, quit appends here */
    proc_ptr         next_quit_sibling;
-   proc_ptr         who_zapped;
-   proc_ptr         next_who_zapped;
-   char            name[MAXNAME];     /* process's name */
-   char            start_arg[MAXARG];  /* args passed to process */
-   context         state;             /* current context for process */
-   short           pid;               /* process id */
+   proc_ptr         next_waiting;      /* wait queue links */
+   proc_ptr         prev_waiting;
+   wait_queue      *waiting_on;        /* wait queue this process is on, if any */
+   wait_queue       join_waiters;      /* the process blocked in join */
+   wait_queue       zappers;           /* processes blocked in zap of this one */
+   proc_cold       *cold;              /* rarely used fields, see below */
+   int             pid;               /* process id */
    int             priority;
-   int (* start_func) (char *);        /* function where process begins -- launch */
-   char           *stack;
-   unsigned int    stacksize;
+   int             level;             /* ready queue, the priority unless SCHED_MLFQ moved it */
    int             status;            /* READY, BLOCKED, QUIT, etc. */
    int             quit_status;
    int             start_time;
    int             zapped;
+   int             cpu_time;          /* total time spent RUNNING */
+   int             ready_time;        /* total time spent waiting while READY */
+   int             blocked_time;      /* total time spent blocked */
+   int             int_time;          /* part of cpu_time spent in interrupt handlers */
+   int             vol_switches;      /* switched out after blocking or quitting */
+   int             invol_switches;    /* switched out while still READY */
+   int             state_time;        /* sys_clock() when status was last changed */
+   int             in_interrupt;      /* interrupt handler nesting depth */
+   long long       pass;              /* SCHED_STRIDE virtual time, lowest runs */
+};
+
+/*
+ * The parts of a process only used at fork1, launch, context switch and
+ * for printing, kept out of proc_struct so that walking the process table
+ * or the ready queues touches as few cache lines as possible. Slot 's'
+ * of ProcTable uses slot 's' of the cold table.
+ */
+struct proc_cold {
+   char            name[MAXNAME];     /* process's name */
+   char            start_arg[MAXARG];  /* args passed to process */
+   int (* start_func) (char *);        /* function where process begins -- launch */
+   char           *stack;
+   unsigned int    stacksize;
+   context         state;             /* current context for process */
+};
+
+/* One FIFO of ready processes for a single priority level */
+struct ready_queue {
+   proc_ptr         head;
+   proc_ptr         tail;
+};
+
+/* Free stacks of one size class, a multiple of USLOSS_MIN_STACK */
+struct stack_pool {
+   char           **free_stacks;     /* num_proc_slots entries */
+   int              num_free;
 };
 
 struct psr_bits {
@@ -56,19 +110,19 @@ union psr_values {
    unsigned int integer_part;
 };
 
-int get_psr_cur_mode(int psr_value) {
+static inline int get_psr_cur_mode(int psr_value) {
     return psr_value & 1;
 }
 
-int get_psr_cur_interrupt_mode(int psr_value) {
+static inline int get_psr_cur_interrupt_mode(int psr_value) {
     return psr_value & 2;
 }
 
-int get_psr_prev_mode(int psr_value) {
+static inline int get_psr_prev_mode(int psr_value) {
     return psr_value & 4;
 }
 
-int get_psr_prev_interrupt_mode(int psr_value) {
+static inline int get_psr_prev_interrupt_mode(int psr_value) {
     return psr_value & 8;
 }
 
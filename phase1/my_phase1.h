@@ -6,10 +6,18 @@ int sentinel (char *);
 extern int start1 (char *);
 void launch();
 static void check_deadlock();
+void print_wait_for_graph();
+int check_io();
 void add_proc_to_ready_list(proc_ptr proc);
 void print_ready_list();
 int get_proc_slot();
 void init_proc_table(int pid);
+void free_proc_slot(int slot);
+void release_proc_slot(int pid);
+proc_ptr pid_to_proc(int pid);
+int next_used_slot(int slot);
+void alloc_proc_table();
+void trace_init();
 void remove_from_child_list(proc_ptr process);
 void remove_from_quit_list(proc_ptr process);
 void clock_handler();
@@ -17,6 +25,22 @@ void disableInterrupts();
 void enableInterrupts();
 void add_to_quit_child_list(proc_ptr ptr);
 void remove_from_ready_list(proc_ptr process);
-void unblock_zappers(proc_ptr ptr);
+proc_ptr ready_list_head();
+void switch_to(proc_ptr old, proc_ptr next, int voluntary);
+void charge_stride(proc_ptr proc);
+void sched_init();
+void set_level(proc_ptr proc, int level);
+void age_processes();
+void charge_proc_time(proc_ptr proc);
+void set_proc_status(proc_ptr proc, int status);
+void block_on(wait_queue *queue, int status);
+void wake_proc(proc_ptr proc);
+int wake_waiters(wait_queue *queue, int max);
+int in_critical_section();
+void wakeup_dispatch(int critical);
+void count_status(int status, int delta);
+unsigned int stack_class_size(unsigned int size);
+char *stack_alloc(unsigned int size);
+void stack_free(char *stack, unsigned int size);
 
 #endif
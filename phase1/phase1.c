@@ -10,27 +10,100 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <limits.h>
+#include <strings.h>
+#include <unistd.h>
+#include <sys/mman.h>
 #include <phase1.h>
 #include "kernel.h"
 #include "my_phase1.h"
+#include "trace.h"
 
 /* -------------------------- Globals ------------------------------------- */
 
 int debugflag = 0;
 
-// The process table with a max number of slots defined by MAXPROC
-proc_struct ProcTable[MAXPROC];
+// Set to have check_deadlock print the wait-for graph before halting
+int deadlock_graph_check = 0;
+
+// The process table, num_proc_slots entries allocated by startup()
+proc_struct *ProcTable;
+
+// Names, arguments, stacks and contexts of the processes in ProcTable
+static proc_cold *ProcCold;
+
+// Number of process table slots, MAXPROC unless PHASE1_MAXPROC is larger
+int num_proc_slots = MAXPROC;
+
+// Bit 's % 64' of SlotBitmap[s / 64] is set while slot 's' is in use, so
+// scans of the table skip runs of empty slots
+static unsigned long *SlotBitmap;
 
 // Process lists
-// The ReadyList process pointer will act as a linked list of 'ready' processes
-// As a proc_ptr, contains the 'next_proc_ptr' pointer, etc.
-static proc_ptr ReadyList;
+// The ReadyList holds one FIFO queue of 'ready' processes per priority level,
+// indexed by priority (MAXPRIORITY through SENTINELPRIORITY)
+// Each queue is doubly linked through 'next_proc_ptr' and 'prev_proc_ptr'
+static ready_queue ReadyList[SENTINELPRIORITY + 1];
+
+// Bit 'p' of ReadyBitmap is set while ReadyList[p] is not empty,
+// so the highest priority ready process is found without walking a list
+static unsigned int ReadyBitmap;
 
 // 'Current' is the running process managed by the dispatcher
 proc_ptr Current;
 
-// the next pid to be assigned
-unsigned int next_pid = SENTINELPID;
+// Free process table slots, a FIFO ring so slots are reused in the order
+// they were freed and the first num_proc_slots processes get pids 1, 2, 3, ...
+static int *FreeSlots;
+static int free_slot_head = 0;
+static int num_free_slots = 0;
+
+// Generation of each slot, the next pid for slot 's' is
+// SlotGeneration[s] * num_proc_slots + s, so pid % num_proc_slots is
+// always the slot
+static int *SlotGeneration;
+
+// Pools of free process stacks, one per size class of USLOSS_MIN_STACK multiples
+static stack_pool StackPool[STACK_CLASSES + 1];
+
+// An unpooled stack released by the process still running on it,
+// unmapped by the next stack_alloc once that process is gone
+static char *DeadStack = NULL;
+static unsigned int DeadStackSize = 0;
+
+// Live counts of processes, kept up to date by fork1, set_proc_status and
+// release_proc_slot so the sentinel can detect deadlock without a table scan
+static int num_procs = 0;      // processes in the process table
+static int num_runnable = 0;   // READY or RUNNING processes
+static int num_blocked = 0;    // JOIN_BLOCKED, ZAP_BLOCKED or blocked by block_me
+
+// Number of dispatches that swapped contexts, and that kept the running process
+int switch_count = 0;
+int no_switch_count = 0;
+
+// Time slice for each priority level, TIME_SLICE unless set by set_time_slice
+static int TimeSlice[SENTINELPRIORITY + 1];
+
+// When set, clock ticks skip the preemption check for a process that is
+// the only one on its priority level
+int tickless_sched = 0;
+
+// Number of clock ticks that skipped the preemption check
+int skipped_ticks = 0;
+
+// Set when a woken process outranks the running one, the dispatcher then
+// runs once the waker leaves its critical section
+int need_resched = 0;
+
+// Scheduling policy, SCHED_PRIORITY unless PHASE1_SCHED says otherwise
+int sched_policy = SCHED_PRIORITY;
+
+// SCHED_STRIDE pass of the last dispatched process, processes joining the
+// ready list start from here
+static long long global_pass = 0;
+
+// sys_clock() when SCHED_MLFQ last returned every process to its priority
+static int last_aging = 0;
 
 
 
@@ -54,10 +127,27 @@ void startup() {
         console("startup(): initializing process table, ProcTable[]\n");
     }
 
+    // Allocate the process table and its slot bookkeeping
+    alloc_proc_table();
+
+    // Start the scheduler trace if one was asked for
+    trace_init();
+
+    // Pick the scheduling policy
+    sched_init();
+
     // Initialize each slot on the process table
     int i;
-    for (i = 0; i < MAXPROC; i++) {
+    for (i = 0; i < num_proc_slots; i++) {
         init_proc_table(i);
+        SlotGeneration[i] = 0;
+    }
+
+    // Every slot starts free, slot 0 is handed out last as pid
+    // num_proc_slots since pid 0 is never used
+    SlotGeneration[0] = 1;
+    for (i = 1; i <= num_proc_slots; i++) {
+        free_proc_slot(i % num_proc_slots);
     }
 
     // Debug info 
@@ -66,7 +156,16 @@ void startup() {
     }
 
     // Initialize Ready List
-    ReadyList = NULL;
+    for (i = 0; i <= SENTINELPRIORITY; i++) {
+        ReadyList[i].head = NULL;
+        ReadyList[i].tail = NULL;
+    }
+    ReadyBitmap = 0;
+
+    // Every level starts with the default time slice
+    for (i = 0; i <= SENTINELPRIORITY; i++) {
+        TimeSlice[i] = TIME_SLICE;
+    }
 
     // Initialize the clock interrupt handler
     int_vec[CLOCK_DEV] = clock_handler;
@@ -174,7 +273,7 @@ int fork1(char *name, int (*start_func)(char *), char *arg, int stacksize, int p
     }
 
     // Return -1 if the given priority is out of bounds
-    if ((next_pid != SENTINELPID) && (priority > MINPRIORITY || priority < MAXPRIORITY)) {
+    if ((start_func != sentinel) && (priority > MINPRIORITY || priority < MAXPRIORITY)) {
         if (DEBUG && debugflag) {
             console("fork1(): Process %s priority is out of bounds!\n", name);
         }
@@ -197,6 +296,7 @@ int fork1(char *name, int (*start_func)(char *), char *arg, int stacksize, int p
         }
         return -1;
     }
+    num_procs++;
 
     // Halt USLOSS if process name is too long
     if ( strlen(name) >= (MAXNAME - 1) ) {
@@ -205,43 +305,45 @@ int fork1(char *name, int (*start_func)(char *), char *arg, int stacksize, int p
     }
 
     // Initializing proc_struct in ProcTable for index proc_slot 
-    ProcTable[proc_slot].pid = next_pid;
-    strcpy(ProcTable[proc_slot].name, name);
-    ProcTable[proc_slot].start_func = start_func;
+    ProcTable[proc_slot].pid = SlotGeneration[proc_slot] * num_proc_slots + proc_slot;
+
+    // Advance the slot's generation so its next pid is different,
+    // wrapping before the pid would overflow
+    SlotGeneration[proc_slot]++;
+    if ((long) SlotGeneration[proc_slot] * num_proc_slots + proc_slot > INT_MAX) {
+        SlotGeneration[proc_slot] = (proc_slot == 0) ? 1 : 0;
+    }
+    strcpy(ProcTable[proc_slot].cold->name, name);
+    ProcTable[proc_slot].cold->start_func = start_func;
 
     // Initialization of the process slot info, and error checking for process argument 
     if (arg == NULL) {
-        ProcTable[proc_slot].start_arg[0] = '\0';
+        ProcTable[proc_slot].cold->start_arg[0] = '\0';
     } else if ( strlen(arg) >= (MAXARG - 1) ) {
         console("fork1(): argument too long.  Halting...\n");
         halt(1);
     } else {
-        strcpy(ProcTable[proc_slot].start_arg, arg);
+        strcpy(ProcTable[proc_slot].cold->start_arg, arg);
     }
-    ProcTable[proc_slot].stacksize = stacksize;
-    if ((ProcTable[proc_slot].stack = malloc(stacksize)) == NULL) {
-        console("fork1(): malloc fail!  Halting...\n");
+    // Take a stack from the pool, stacksize is rounded up to its size class
+    ProcTable[proc_slot].cold->stacksize = stack_class_size(stacksize);
+    if ((ProcTable[proc_slot].cold->stack = stack_alloc(ProcTable[proc_slot].cold->stacksize)) == NULL) {
+        console("fork1(): stack allocation fail!  Halting...\n");
         halt(1);
     }
     ProcTable[proc_slot].priority = priority;
+    ProcTable[proc_slot].level = priority;
 
     // Set parent, child, and sibling pointers 
     if (Current != NULL) {                      // Current is the parent process
         if (Current->child_proc_ptr == NULL) {  // Current has no children
             Current->child_proc_ptr = &ProcTable[proc_slot];
         } else {  // Current has children
-            // Extract the 'Current's child process
-            proc_ptr child = Current->child_proc_ptr;
-
             // Insert the new child at end of sibling list
-            // Continue moving down the chain until we find an empty slot
-            while (child->next_sibling_ptr != NULL) {
-                child = child->next_sibling_ptr;
-            }
-
-            // We are at an empty slot, store the new child process
-            child->next_sibling_ptr = &ProcTable[proc_slot];
+            Current->child_tail_ptr->next_sibling_ptr = &ProcTable[proc_slot];
+            ProcTable[proc_slot].prev_sibling_ptr = Current->child_tail_ptr;
         }
+        Current->child_tail_ptr = &ProcTable[proc_slot];
     }
 
     ProcTable[proc_slot].parent_ptr = Current;
@@ -252,10 +354,10 @@ int fork1(char *name, int (*start_func)(char *), char *arg, int stacksize, int p
     // function set in 'start_func' of the new process with its argument of 'start_arg'
     // By the time the 'launch' function is called, the process created will be set as the current by dispatcher
     context_init(
-        &(ProcTable[proc_slot].state), 
+        &(ProcTable[proc_slot].cold->state), 
         psr_get(),
-        ProcTable[proc_slot].stack,
-        ProcTable[proc_slot].stacksize,
+        ProcTable[proc_slot].cold->stack,
+        ProcTable[proc_slot].cold->stacksize,
         launch
     );
 
@@ -263,12 +365,9 @@ int fork1(char *name, int (*start_func)(char *), char *arg, int stacksize, int p
     p1_fork(ProcTable[proc_slot].pid); 
 
     // Make process ready and add to ready list 
-    ProcTable[proc_slot].status = READY;
+    set_proc_status(&ProcTable[proc_slot], READY);
     add_proc_to_ready_list(&ProcTable[proc_slot]);
 
-    // Increment for next process to start at this pid
-    next_pid++;  
-
     // Sentinel doesn't call dispatcher when it is first created, handle it now
     if (ProcTable[proc_slot].pid != SENTINELPID) {
         dispatcher();
@@ -301,7 +400,7 @@ void launch()
     enableInterrupts();
 
     // Call the function passed to fork1, and capture its return value
-    result = Current->start_func(Current->start_arg);
+    result = Current->cold->start_func(Current->cold->start_arg);
 
     // Debug info
     if (DEBUG && debugflag) {
@@ -342,7 +441,7 @@ int join(int *status) {
 
     // Debug info
     if (DEBUG && debugflag) {
-        console("join(): Process %s is disabling interrupts.\n", Current->name);
+        console("join(): Process %s is disabling interrupts.\n", Current->cold->name);
     }
 
     // Disable interrupts
@@ -352,7 +451,7 @@ int join(int *status) {
     if (Current->child_proc_ptr == NULL && Current->quit_child_ptr == NULL) {
         // Debug info
 	if (DEBUG && debugflag) {
-            console("join(): Process %s has no children.\n", Current->name);
+            console("join(): Process %s has no children.\n", Current->cold->name);
         }
 
 	// Return -2, running process has no children
@@ -362,22 +461,16 @@ int join(int *status) {
 
     // No children have called 'quit' yet
     if (Current->quit_child_ptr == NULL) {
-        // The current process is now waiting for the child to call 'quit',
-	// set status accordingly
-	Current->status = JOIN_BLOCKED;
-
-	// The process is blocked (waiting on an event, for child to call 'quit')
-        remove_from_ready_list(Current);
-        
 	// Debug info
 	if (DEBUG && debugflag) {
-            console("join(): %s is JOIN_BLOCKED.\n", Current->name);
+            console("join(): %s is JOIN_BLOCKED.\n", Current->cold->name);
             dump_processes();
             print_ready_list();
         }
 
-	// Call the dispatcher to set a new current process while this is blocked
-        dispatcher();
+        // The current process is now waiting for the child to call 'quit',
+        // the first child to quit wakes it
+        block_on(&Current->join_waiters, JOIN_BLOCKED);
     }
     
     // REMOVE
@@ -391,7 +484,7 @@ int join(int *status) {
 
     // Debug info
     if (DEBUG && debugflag) {
-        console("join(): Child %s has status of quit.\n", child->name);
+        console("join(): Child %s has status of quit.\n", child->cold->name);
         dump_processes();
         print_ready_list();
     }
@@ -404,7 +497,7 @@ int join(int *status) {
     remove_from_quit_list(child);
 
     // Re-initialize the PID on the process table since the child was removed
-    init_proc_table(child_pid);
+    release_proc_slot(child_pid);
 
     /* Process was zapped while JOIN_BLOCKED */
     if(is_zapped()){
@@ -443,7 +536,7 @@ void quit(int status) {
 
     // Debug info
     if (DEBUG && debugflag) {
-        console("quit(): Process %s is disabling interrupts.\n", Current->name);
+        console("quit(): Process %s is disabling interrupts.\n", Current->cold->name);
     }
 
     // Disable interrupts
@@ -451,26 +544,26 @@ void quit(int status) {
 
     // Debug info
     if (DEBUG && debugflag) {
-        console("quit(): Quitting %s, status is %d.\n", Current->name, status);
+        console("quit(): Quitting %s, status is %d.\n", Current->cold->name, status);
     }
 
     // The process has an active child
     // Halt USLOSS
     if (Current->child_proc_ptr != NULL) {
-        console("quit(): process %d, '%s', has active children. Halting...\n", Current->pid, Current->name);
+        console("quit(): process %d, '%s', has active children. Halting...\n", Current->pid, Current->cold->name);
         halt(1);
     }
 
     // Update the 'Current' process variables including: exit status, set status to QUIT
     // Remove from the ReadyList
     Current->quit_status = status;
-    Current->status = QUIT;
+    set_proc_status(Current, QUIT);
     remove_from_ready_list(Current);
 
     // For all processes that zapped this process, add to ready list and
     // set status to READY. 
     if (is_zapped()) {
-        unblock_zappers(Current->who_zapped);
+        wake_waiters(&Current->zappers, num_proc_slots);
     }
 
     // The process that is quitting is a child and has its own quit child 
@@ -482,18 +575,17 @@ void quit(int status) {
         while (Current->quit_child_ptr != NULL) {
             int child_pid = Current->quit_child_ptr->pid;
             remove_from_quit_list(Current->quit_child_ptr);
-            init_proc_table(child_pid);
+            release_proc_slot(child_pid);
         }
 
-        // Clean up self and activate parent by changing status to READY 
-        Current->parent_ptr->status = READY;
+        // Clean up self
         remove_from_child_list(Current);
 
         // Add self to the parent's quit child list
         add_to_quit_child_list(Current->parent_ptr);
 
-        // Finally, add the parent back to the ready list
-        add_proc_to_ready_list(Current->parent_ptr);
+        // Finally, wake the parent if it is waiting in join
+        wake_waiters(&Current->parent_ptr->join_waiters, 1);
         
         // Only prints in debug mode
         print_ready_list();                        
@@ -512,14 +604,14 @@ void quit(int status) {
         
         // If the parent is JOIN_BLOCKED, activate the parent by changing status to READY,
         // and add to the Ready List
-        if(Current->parent_ptr->status == JOIN_BLOCKED){
-           add_proc_to_ready_list(Current->parent_ptr);
-           Current->parent_ptr->status = READY;
-        }
+        wake_waiters(&Current->parent_ptr->join_waiters, 1);
 
         // Only prints in debug mode
         print_ready_list();                        
 
+        // Update the current PID
+        currentPID = Current->pid;
+
     // The process that is quitting is only a parent 
     } else {
 
@@ -529,14 +621,14 @@ void quit(int status) {
         while (Current->quit_child_ptr != NULL) {
             int child_pid = Current->quit_child_ptr->pid;
             remove_from_quit_list(Current->quit_child_ptr);
-            init_proc_table(child_pid);
+            release_proc_slot(child_pid);
         }
 
         // Update the current PID
         currentPID = Current->pid;
 
         // Clear the process table slot this process was occupying
-        init_proc_table(Current->pid);
+        release_proc_slot(Current->pid);
     }
 
     // p1_quit
@@ -580,7 +672,7 @@ int zap(int pid) {
     }
     if (DEBUG && debugflag) {
         console("zap(): Process %s is disabling interrupts.\n",
-                       Current->name);
+                       Current->cold->name);
     }
     disableInterrupts();
 
@@ -592,8 +684,8 @@ int zap(int pid) {
     }
 
     /* Process to zap does not exist */
-    if (ProcTable[pid % MAXPROC].status == EMPTY ||
-            ProcTable[pid % MAXPROC].pid != pid) {
+    zap_ptr = pid_to_proc(pid);
+    if (zap_ptr == NULL || zap_ptr->status == EMPTY) {
 
         console("zap(): process being zapped does not exist."
                        "  Halting...\n");
@@ -601,7 +693,7 @@ int zap(int pid) {
     }
 
     /* Process to zap has finished running, but is still waiting for parent */
-    if (ProcTable[pid % MAXPROC].status == QUIT) {
+    if (zap_ptr->status == QUIT) {
         if (DEBUG && debugflag) {
             console("zap(): process being zapped has quit but not"
                     " joined.\n");
@@ -617,20 +709,10 @@ int zap(int pid) {
         console("zap(): Process %d is zapping process %d.\n",
                 Current->pid, pid);
     }
-    Current->status = ZAP_BLOCKED;
-    remove_from_ready_list(Current);
-    zap_ptr = &ProcTable[pid % MAXPROC];
     zap_ptr->zapped = 1;
 
-    /* Add this process to the list of process who have zapped the process */
-    if (zap_ptr->who_zapped == NULL) {
-        zap_ptr->who_zapped = Current;
-    } else {
-        proc_ptr ptr = zap_ptr->who_zapped;
-        zap_ptr->who_zapped = Current;
-        zap_ptr->who_zapped->next_who_zapped = ptr;
-    }
-    dispatcher();
+    /* Wait with the other processes who have zapped the process until it quits */
+    block_on(&zap_ptr->zappers, ZAP_BLOCKED);
     if (is_zapped()) {
         return -1;
     }
@@ -670,74 +752,123 @@ void dispatcher(void) {
         console("dispatcher(): started.\n");
     }
 
+    // Any deferred reschedule is handled by this dispatch
+    need_resched = 0;
+
     // Dispatcher is called for the first time for starting process (start1) 
     if (Current == NULL) {
-	// Set 'Current' as 'ReadyList'
-        Current = ReadyList;
+	// Set 'Current' as the head of the Ready List
+        Current = ready_list_head();
 
 	// Debug info
         if (DEBUG && debugflag) {
-            console("dispatcher(): dispatching %s.\n", Current->name);
+            console("dispatcher(): dispatching %s.\n", Current->cold->name);
         }
 
 	// Set the Current process start time to now
         Current->start_time = sys_clock();
+        set_proc_status(Current, RUNNING);
 
         // Enable Interrupts - returning to user code 
         psr_set( psr_get() | PSR_CURRENT_INT );
         
 	// Perform context switch
-	// Current->state is a context containing the function pointer for the process
-	context_switch(NULL, &Current->state);
+	// Current->cold->state is a context containing the function pointer for the process
+	context_switch(NULL, &Current->cold->state);
     
     // There is a current running process
     } else {
 	// Set the current running process into the 'old' process pointer	
         proc_ptr old = Current;
 
+        // Under SCHED_STRIDE the old process pays for the time it ran
+        if (sched_policy == SCHED_STRIDE) {
+            charge_stride(old);
+        }
+
 	// Change status from RUNNING to READY
         if (old->status == RUNNING) {
-            old->status = READY;
+            set_proc_status(old, READY);
         }
 	
-	// Set the Current process as the next in the Ready List
-        Current = ReadyList;
-	
-	// Remove the new Current process from the Ready List
-        remove_from_ready_list(Current);
-
-	// Set the new Current process status to RUNNING
-        Current->status = RUNNING;
+	// Run the next process in the Ready List, a process still READY
+	// is being preempted
+        switch_to(old, ready_list_head(), old->status != READY);
+    }
 
-	// Add the new Current process back to the end of the Ready List
-        add_proc_to_ready_list(Current);
+    // Debug info
+    if (DEBUG && debugflag){
+        console("dispatcher(): Printing process table");
+        dump_processes();
+    }
 
-	// Debug info
-        if (DEBUG && debugflag) {
-            console("dispatcher(): dispatching %s.\n", Current->name);
-        }
+} /* dispatcher */
 
-	// Set the Current process start time to now
-        Current->start_time = sys_clock();
+/*------------------------------------------------------------------
+|  Function switch_to
+|
+|  Purpose:  Makes a READY process the Current one and switches to it.
+|            The second half of the dispatcher, once the next process
+|            has been chosen.
+|
+|  Parameters:
+|            proc_ptr old - the process that was running, no longer
+|                           RUNNING
+|            proc_ptr next - the process to run, may be old
+|            int voluntary - whether old gave up the CPU itself, for
+|                            its switch counts
+|
+|  Returns:  void, once old runs again
+*-------------------------------------------------------------------*/
+void switch_to(proc_ptr old, proc_ptr next, int voluntary) {
+    // Set the Current process as the next one
+    Current = next;
+    global_pass = Current->pass;
 
-	// p1_switch 
-        p1_switch(old->pid, Current->pid);
+    // Remove the new Current process from the Ready List
+    remove_from_ready_list(Current);
 
-        // Enable Interrupts - returning to user code 
-	enableInterrupts();
+    // Set the new Current process status to RUNNING
+    set_proc_status(Current, RUNNING);
 
-	// Perform context switch from old process to new current process
-	// Current->state is a context containing the function pointer for the process
-        context_switch(&old->state, &Current->state);
-    }
+    // Add the new Current process back to the end of the Ready List
+    add_proc_to_ready_list(Current);
 
     // Debug info
-    if (DEBUG && debugflag){
-        console("dispatcher(): Printing process table");
-        dump_processes();
+    if (DEBUG && debugflag) {
+        console("dispatcher(): dispatching %s.\n", Current->cold->name);
     }
 
-} /* dispatcher */
+    // Set the Current process start time to now
+    Current->start_time = sys_clock();
+
+    // The running process was selected again (e.g. it is alone at its priority),
+    // so there is no context to swap, just start its new time slice
+    if (Current == old) {
+        no_switch_count++;
+
+        // Enable Interrupts - returning to user code 
+        enableInterrupts();
+    } else {
+        switch_count++;
+
+        if (voluntary) {
+            old->vol_switches++;
+        } else {
+            old->invol_switches++;
+        }
+
+        // p1_switch 
+        p1_switch(old->pid, Current->pid);
+
+        // Enable Interrupts - returning to user code 
+        enableInterrupts();
+
+        // Perform context switch from old process to new current process
+        // Current->cold->state is a context containing the function pointer for the process
+        context_switch(&old->cold->state, &Current->cold->state);
+    }
+} /* switch_to */
 
 
 /* ------------------------------------------------------------------------
@@ -771,10 +902,11 @@ int sentinel (char *dummy) {
 /* ------------------------------------------------------------------------
 |  Name - check_deadlock
 |
-|  Purpose - Checks to determine if a deadlock has occured. In phase1, a
-|            deadlock will occur if check_deadlock is called and there
-|            are any processes, other then Sentinel, with a status other
-|            then empty in the process table.
+|  Purpose - Checks to determine if a deadlock has occured. The sentinel
+|            only runs when no other process is ready, so a deadlock has
+|            occured if processes other than Sentinel remain and none of
+|            them is waiting on a device (check_io). Uses the live process
+|            counts, so no process table scan is needed.
 |
 |  Parameters - none
 |
@@ -786,53 +918,111 @@ int sentinel (char *dummy) {
 |                 table.
 *------------------------------------------------------------------------- */
 static void check_deadlock(){
-    int numProc = 0; // Number of processes in the process table
+    // Only the sentinel is left, USLOSS can halt
+    if (num_procs == 1) {
+        console("All processes completed.\n");
+        halt(0);
+    }
+
+    // Another process can still run, or a process waiting on a device
+    // will be woken by an interrupt, return back to the sentinel to wait
+    if (num_runnable > 1 || check_io()) {
+        if (DEBUG && debugflag) {
+            console("check_deadlock(): %d runnable, %d blocked.\n",
+                    num_runnable, num_blocked);
+        }
+        return;
+    }
 
-    /* Check the status of every entry in the process table. Increment
-     * numProc if a process status in not EMPTY
-     */
+    // Every other process is blocked on something no process or
+    // interrupt can provide
+    if (deadlock_graph_check) {
+        print_wait_for_graph();
+    }
+    console("check_deadlock(): numProc = %d. Only Sentinel should be left. Halting...\n", num_procs);
+    halt(1);
+} /* check_deadlock */
+
+/* ------------------------------------------------------------------------
+|  Name - print_wait_for_graph
+|
+|  Purpose - Prints which process each blocked process is waiting for, and
+|            any cycle among them. A JOIN_BLOCKED process waits for its
+|            children, and a ZAP_BLOCKED process waits for the process it
+|            zapped. Processes blocked by block_me wait on a later phase.
+|
+|  Parameters - none
+|
+|  Returns - nothing
+|
+|  Side Effects - none, only called by check_deadlock once it has found
+|                 no process can make progress
+*------------------------------------------------------------------------- */
+void print_wait_for_graph() {
+    proc_ptr *waits_for;  // the process each blocked process waits for
     int i;
-    for (i = 0; i < MAXPROC; i++) {
-        if (ProcTable[i].status != EMPTY) {
-            numProc++;
+
+    console("print_wait_for_graph(): blocked processes:\n");
+
+    waits_for = calloc(num_proc_slots, sizeof(proc_ptr));
+    if (waits_for == NULL) {
+        return;
+    }
+
+    // A ZAP_BLOCKED process is on the zappers queue of its target
+    for (i = next_used_slot(0); i >= 0; i = next_used_slot(i + 1)) {
+        proc_ptr zapper;
+        for (zapper = ProcTable[i].zappers.head; zapper != NULL;
+                zapper = zapper->next_waiting) {
+            waits_for[zapper->pid % num_proc_slots] = &ProcTable[i];
         }
     }
 
-    // EDITING THIS FOR PHASE 2 TESTING
+    for (i = next_used_slot(0); i >= 0; i = next_used_slot(i + 1)) {
+        proc_ptr proc = &ProcTable[i];
+        proc_ptr child;
 
-    // THIS IS NOT A COMPLETE CHECK DEADLOCK! 
-    // It should use a dummy form of check_io() defined in p1.c that just constantly returns 0 for phase 1
-    // In phase 2, we implement a version of check_io() that checks for mailboxes waiting    
+        if (proc->status == JOIN_BLOCKED) {
+            waits_for[i] = proc->child_proc_ptr;
+            for (child = proc->child_proc_ptr; child != NULL;
+                    child = child->next_sibling_ptr) {
+                console("    %d (%s) JOIN_BLOCKED on child %d (%s)\n",
+                        proc->pid, proc->cold->name, child->pid, child->cold->name);
+            }
+        } else if (proc->status == ZAP_BLOCKED && waits_for[i] != NULL) {
+            console("    %d (%s) ZAP_BLOCKED on %d (%s)\n", proc->pid,
+                    proc->cold->name, waits_for[i]->pid, waits_for[i]->cold->name);
+        } else if (proc->status == BLOCKED || proc->status > ZAP_BLOCKED) {
+            console("    %d (%s) blocked with status %d\n", proc->pid,
+                    proc->cold->name, proc->status);
+        }
+    }
 
-    // Check for processes still running
-    // If processes exist, return back to the sentinel to continue waiting
-    // Todo: how will the Sentinel know if processes are stuck?
-    if(numProc > 1){
-        if (DEBUG && debugflag) {
-            console("check_deadlock(): dumping processes...\n");
-            dump_processes();
-            console("check_deadlock(): There are still processes on the table.");
+    // Follow the first wait edge of each process looking for a cycle,
+    // a path longer than num_procs must revisit a process
+    for (i = next_used_slot(0); i >= 0; i = next_used_slot(i + 1)) {
+        proc_ptr proc = waits_for[i];
+        int steps = 0;
+
+        while (proc != NULL && proc != &ProcTable[i] && steps < num_procs) {
+            proc = waits_for[proc->pid % num_proc_slots];
+            steps++;
         }
-        
-        // Removed these lines from phase 1 implementation:
-        // console("check_deadlock(): numProc = %d. Only Sentinel should be left. Halting...\n", numProc);
-        // halt(1);
+        if (proc == &ProcTable[i]) {
+            console("print_wait_for_graph(): process %d (%s) is in a wait cycle\n",
+                    ProcTable[i].pid, ProcTable[i].cold->name);
+        }
+    }
 
-        // Changed to 'return' to allow Sentinel to continue, instead of halting in phase 1
-        // This will allow blocked processes to continue running so they can complete
-        return;
-    } 
-    
-    // At this point, there are no other processes on the process table. USLOSS can halt.
-    console("All processes completed.\n");
-    halt(0);
-} /* check_deadlock */
+    free(waits_for);
+} /* print_wait_for_graph */
 
 /*
  * Enable interrupts
  */
 void enableInterrupts() {
     psr_set(psr_get() | PSR_CURRENT_INT);
+    resched();
 }
 
 /*
@@ -855,9 +1045,8 @@ void disableInterrupts()
 |  Function add_proc_to_ready_list
 |
 |  Purpose:  Adds a new process to the ready list. Process is added to
-|            the list based on priority. Lower priorities are placed at
-|            the front of the list. A process is placed at the end of
-|            all processes with the same pritority.
+|            the tail of the queue for its priority, behind all processes
+|            with the same priority. Constant time.
 |
 |  Parameters:  proc (IN) -- The process to be added to the ready list.
 |
@@ -873,44 +1062,51 @@ void disableInterrupts()
 void add_proc_to_ready_list(proc_ptr proc) {
     // Debug info
     if (DEBUG && debugflag) {
-      console("add_proc_to_ready_list(): Adding process %s to ReadyList\n", proc->name);
+      console("add_proc_to_ready_list(): Adding process %s to ReadyList\n", proc->cold->name);
     }
 
-    // Process being added is the Sentinel process 
-    if (ReadyList == NULL) {
-        ReadyList = proc;
-    } else {
-        // Check if all priorities in list are less than the given process in the argument
-        // If the priority of the first process in the list is a higher priority number (less important),
-        // insert this process at the front of the list since it is more important.
-        if(ReadyList->priority > proc->priority) {
-            proc_ptr temp = ReadyList;
-            ReadyList = proc;
-            proc->next_proc_ptr = temp;
-
-        // Add process before first greater priority 
-        // Continue iterating through ReadyList until we find the next process that is less important,
-        // then, insert this process in front of it.
-        } else {
-            // Temp variables to keep track of iterations and position in chain
-            proc_ptr next = ReadyList->next_proc_ptr;
-            proc_ptr last = ReadyList;
-
-            // Continue down chain until 'next' has a priority that is less important than the given new process
-            while (next->priority <= proc->priority) {
-                last = next;
-                next = next->next_proc_ptr;
-            }
+    ready_queue *queue = &ReadyList[proc->level];
+
+    // The process is already on its ready queue, don't link it in twice
+    if (proc->prev_proc_ptr != NULL || queue->head == proc) {
+        return;
+    }
 
-            // Insert new process in the list since we are now in the correct priority position
-            last->next_proc_ptr = proc;
-            proc->next_proc_ptr = next;
+    // The process goes at the tail of the queue for its priority
+    proc_ptr after = queue->tail;
+
+    // Under SCHED_STRIDE the queue is kept in pass order, equal passes in
+    // the order they were added. A process that was not runnable gets no
+    // credit for the time it was away.
+    if (sched_policy == SCHED_STRIDE) {
+        if (proc->pass < global_pass) {
+            proc->pass = global_pass;
+        }
+        while (after != NULL && after->pass > proc->pass) {
+            after = after->prev_proc_ptr;
         }
     }
+
+    proc->prev_proc_ptr = after;
+    if (after == NULL) {
+        proc->next_proc_ptr = queue->head;
+        queue->head = proc;
+    } else {
+        proc->next_proc_ptr = after->next_proc_ptr;
+        after->next_proc_ptr = proc;
+    }
+    if (proc->next_proc_ptr == NULL) {
+        queue->tail = proc;
+    } else {
+        proc->next_proc_ptr->prev_proc_ptr = proc;
+    }
+
+    // Mark this priority level as having a ready process
+    ReadyBitmap |= (1 << proc->level);
     
     // Debug info
     if (DEBUG && debugflag) {
-        console("add_proc_to_ready_list(): Process %s added to ReadyList\n", proc->name);
+        console("add_proc_to_ready_list(): Process %s added to ReadyList\n", proc->cold->name);
         print_ready_list();
     }
 
@@ -928,27 +1124,39 @@ void add_proc_to_ready_list(proc_ptr proc) {
 |  Returns:  None
 *-------------------------------------------------------------------*/
 void print_ready_list(){
-    char str[10000], str1[40];
+    char str[10000], str1[80];
+    int priority;
+
+    // Only prints in debug mode, don't walk the queues otherwise
+    if (!(DEBUG && debugflag)) {
+        return;
+    }
 
-    proc_ptr head = ReadyList;
+    str[0] = '\0';
 
-    sprintf(str, "%s(%d:PID=%d)", head->name, head->priority, head->pid);
+    // Walk each priority queue from highest to lowest priority, as many
+    // processes as fit in str
+    for (priority = MAXPRIORITY; priority <= SENTINELPRIORITY; priority++) {
+        proc_ptr head = ReadyList[priority].head;
 
-    while (head->next_proc_ptr != NULL) {
-        head = head->next_proc_ptr;
-        sprintf(str1, " -> %s(%d:PID=%d)", head->name, head->priority,
-                head->pid);
-        strcat(str, str1);
-    }
-    if (DEBUG && debugflag){
-      console("print_ready_list(): %s\n", str);
+        while (head != NULL) {
+            snprintf(str1, sizeof(str1), "%s%s(%d:PID=%d)", str[0] == '\0' ? "" : " -> ",
+                    head->cold->name, head->priority, head->pid);
+            if (strlen(str) + strlen(str1) >= sizeof(str)) {
+                break;
+            }
+            strcat(str, str1);
+            head = head->next_proc_ptr;
+        }
     }
+    console("print_ready_list(): %s\n", str);
 } /* print_ready_list */
 
 /*---------------------------- get_proc_slot -----------------------
 |  Function get_proc_slot
 |
-|  Purpose:  Finds an empty index in the process table (ProcTable).
+|  Purpose:  Takes the least recently freed slot off the free slot ring.
+|            Constant time.
 |
 |  Parameters:  None
 |
@@ -956,18 +1164,158 @@ void print_ready_list(){
 |            empty slot in the process table.
 *-------------------------------------------------------------------*/
 int get_proc_slot() {
-    int hashedIndex = next_pid % MAXPROC;
-    int counter = 0;
-    while (ProcTable[hashedIndex].status != EMPTY) {
-        next_pid++;
-        hashedIndex = next_pid % MAXPROC;
-        if (counter >= MAXPROC) {
+    int slot;
+
+    if (num_free_slots == 0) {
+        return -1;
+    }
+
+    slot = FreeSlots[free_slot_head];
+    free_slot_head = (free_slot_head + 1) % num_proc_slots;
+    num_free_slots--;
+    SlotBitmap[slot / SLOT_BITS] |= 1UL << (slot % SLOT_BITS);
+    return slot;
+} /* get_proc_slot */
+
+/*---------------------------- free_proc_slot -----------------------
+|  Function free_proc_slot
+|
+|  Purpose:  Adds an empty slot to the back of the free slot ring.
+|
+|  Parameters:
+|      slot (IN) --  The index of the empty slot
+|
+|  Returns:  void
+*-------------------------------------------------------------------*/
+void free_proc_slot(int slot) {
+    FreeSlots[(free_slot_head + num_free_slots) % num_proc_slots] = slot;
+    num_free_slots++;
+    SlotBitmap[slot / SLOT_BITS] &= ~(1UL << (slot % SLOT_BITS));
+} /* free_proc_slot */
+
+/*---------------------------- release_proc_slot -----------------------
+|  Function release_proc_slot
+|
+|  Purpose:  Clears the slot of a process that is done and makes the
+|            slot available to fork1 again.
+|
+|  Parameters:
+|      pid (IN) --  The process ID whose slot is released
+|
+|  Returns:  void
+*-------------------------------------------------------------------*/
+void release_proc_slot(int pid) {
+    set_proc_status(&ProcTable[pid % num_proc_slots], EMPTY);
+    num_procs--;
+    init_proc_table(pid);
+    free_proc_slot(pid % num_proc_slots);
+} /* release_proc_slot */
+
+/*---------------------------- pid_to_proc -----------------------
+|  Function pid_to_proc
+|
+|  Purpose:  Looks up the process table entry of a pid. The slot is
+|            pid % num_proc_slots, and a stale pid from an earlier generation
+|            of the slot no longer matches the entry's pid.
+|
+|  Parameters:
+|      pid (IN) --  The process ID to look up
+|
+|  Returns:  proc_ptr - the process, NULL if the pid is not in use
+*-------------------------------------------------------------------*/
+proc_ptr pid_to_proc(int pid) {
+    if (pid <= 0 || ProcTable[pid % num_proc_slots].pid != pid) {
+        return NULL;
+    }
+    return &ProcTable[pid % num_proc_slots];
+} /* pid_to_proc */
+
+/*---------------------------- next_used_slot -----------------------
+|  Function next_used_slot
+|
+|  Purpose:  Finds the next process table slot in use, skipping whole
+|            words of SlotBitmap at a time, so scans of a large table
+|            cost little for its empty slots.
+|
+|  Parameters:
+|      slot (IN) --  The first slot to consider
+|
+|  Returns:  int - the first slot in use at or after slot, -1 if none
+*-------------------------------------------------------------------*/
+int next_used_slot(int slot) {
+    int word = slot / SLOT_BITS;
+    int num_words = (num_proc_slots + SLOT_BITS - 1) / SLOT_BITS;
+    unsigned long bits;
+
+    if (slot >= num_proc_slots) {
+        return -1;
+    }
+
+    // Ignore the slots before 'slot' in its word
+    bits = SlotBitmap[word] & (~0UL << (slot % SLOT_BITS));
+    while (bits == 0) {
+        if (++word >= num_words) {
             return -1;
         }
-        counter++;
+        bits = SlotBitmap[word];
     }
-    return hashedIndex;
-} /* get_proc_slot */
+    return word * SLOT_BITS + __builtin_ctzl(bits);
+} /* next_used_slot */
+
+/*---------------------------- alloc_proc_table -----------------------
+|  Function alloc_proc_table
+|
+|  Purpose:  Sizes the process table from the PHASE1_MAXPROC environment
+|            variable (MAXPROC if unset or smaller) and allocates it,
+|            with its cold side table, the stack pools, the free slot
+|            ring, slot generations and slot bitmap, in a single block.
+|
+|  Parameters:  None
+|
+|  Returns:  void
+|
+|  Side Effects:  sets num_proc_slots, halts USLOSS if out of memory
+*-------------------------------------------------------------------*/
+void alloc_proc_table() {
+    char *value = getenv("PHASE1_MAXPROC");
+    int num_words;
+    char *block;
+    char **stacks;
+    int i;
+
+    if (value != NULL && atoi(value) > MAXPROC) {
+        num_proc_slots = atoi(value);
+    }
+    num_words = (num_proc_slots + SLOT_BITS - 1) / SLOT_BITS;
+
+    block = calloc(1, num_proc_slots * sizeof(proc_cold) +
+                      num_proc_slots * sizeof(proc_struct) +
+                      (STACK_CLASSES + 1) * num_proc_slots * sizeof(char *) +
+                      num_words * sizeof(unsigned long) +
+                      2 * num_proc_slots * sizeof(int));
+    if (block == NULL) {
+        console("startup(): cannot allocate %d process slots.  Halting...\n",
+                num_proc_slots);
+        halt(1);
+    }
+
+    // The contexts come first, calloc aligns them for any type
+    ProcCold = (proc_cold *) block;
+    ProcTable = (proc_struct *) (ProcCold + num_proc_slots);
+    stacks = (char **) (ProcTable + num_proc_slots);
+    SlotBitmap = (unsigned long *) (stacks + (STACK_CLASSES + 1) * num_proc_slots);
+    FreeSlots = (int *) (SlotBitmap + num_words);
+    SlotGeneration = FreeSlots + num_proc_slots;
+
+    for (i = 0; i < num_proc_slots; i++) {
+        ProcTable[i].cold = &ProcCold[i];
+    }
+
+    // Each size class can pool a stack for every process slot
+    for (i = 0; i <= STACK_CLASSES; i++) {
+        StackPool[i].free_stacks = stacks + i * num_proc_slots;
+    }
+} /* alloc_proc_table */
 
 /*---------------------------- init_proc_table -----------------------
 |  Function init_proc_table
@@ -982,28 +1330,165 @@ int get_proc_slot() {
 |  Side Effects: The fields of the proc_struct for the given pid are modified
 *-------------------------------------------------------------------*/
 void init_proc_table(int pid) {
-    int index = pid % MAXPROC;
+    int index = pid % num_proc_slots;
+
+    // Return the stack of the process to the pool
+    if (ProcTable[index].cold->stack != NULL) {
+        stack_free(ProcTable[index].cold->stack, ProcTable[index].cold->stacksize);
+    }
+
     ProcTable[index].pid = -1;
-    ProcTable[index].stacksize = -1;
-    ProcTable[index].stack = NULL;
+    ProcTable[index].cold->stacksize = -1;
+    ProcTable[index].cold->stack = NULL;
     ProcTable[index].priority = -1;
+    ProcTable[index].level = -1;
     ProcTable[index].status = EMPTY;
     ProcTable[index].child_proc_ptr = NULL;
+    ProcTable[index].child_tail_ptr = NULL;
     ProcTable[index].next_sibling_ptr = NULL;
+    ProcTable[index].prev_sibling_ptr = NULL;
     ProcTable[index].next_proc_ptr = NULL;
+    ProcTable[index].prev_proc_ptr = NULL;
     ProcTable[index].quit_child_ptr = NULL;
+    ProcTable[index].quit_child_tail = NULL;
     ProcTable[index].next_quit_sibling = NULL;
-    ProcTable[index].who_zapped = NULL;
-    ProcTable[index].next_who_zapped = NULL;
-    ProcTable[index].name[0] = '\0';
-    ProcTable[index].start_arg[0] = '\0';
-    ProcTable[index].start_func = NULL;
+    ProcTable[index].next_waiting = NULL;
+    ProcTable[index].prev_waiting = NULL;
+    ProcTable[index].waiting_on = NULL;
+    wait_queue_init(&ProcTable[index].join_waiters);
+    wait_queue_init(&ProcTable[index].zappers);
+    ProcTable[index].cold->name[0] = '\0';
+    ProcTable[index].cold->start_arg[0] = '\0';
+    ProcTable[index].cold->start_func = NULL;
     ProcTable[index].parent_ptr = NULL;
     ProcTable[index].quit_status = -1;
     ProcTable[index].start_time = -1;
     ProcTable[index].zapped = 0;
+    ProcTable[index].cpu_time = 0;
+    ProcTable[index].ready_time = 0;
+    ProcTable[index].blocked_time = 0;
+    ProcTable[index].int_time = 0;
+    ProcTable[index].vol_switches = 0;
+    ProcTable[index].invol_switches = 0;
+    ProcTable[index].state_time = -1;
+    ProcTable[index].in_interrupt = 0;
+    ProcTable[index].pass = 0;
 } /* init_proc_table */
 
+/*---------------------------- stack_class_size -----------------------
+|  Function stack_class_size
+|
+|  Purpose:  Rounds a requested stack size up to its size class, a
+|            multiple of USLOSS_MIN_STACK.
+|
+|  Parameters:
+|      size (IN) --  The requested stack size in bytes
+|
+|  Returns:  unsigned int - the stack size that will be allocated
+*-------------------------------------------------------------------*/
+unsigned int stack_class_size(unsigned int size) {
+    return ((size + USLOSS_MIN_STACK - 1) / USLOSS_MIN_STACK) * USLOSS_MIN_STACK;
+} /* stack_class_size */
+
+/*---------------------------- stack_alloc -----------------------
+|  Function stack_alloc
+|
+|  Purpose:  Gets a stack of a size class from the stack pool, or maps
+|            a new one. New stacks are mapped with MAP_NORESERVE so the
+|            kernel only commits the pages the process actually touches,
+|            and have an inaccessible guard page below them to catch
+|            stack overflow.
+|
+|  Parameters:
+|      size (IN) --  The stack size, a multiple of USLOSS_MIN_STACK
+|
+|  Returns:  char * - the lowest usable address of the stack, NULL if
+|            no memory could be mapped
+*-------------------------------------------------------------------*/
+char *stack_alloc(unsigned int size) {
+    int size_class = size / USLOSS_MIN_STACK;
+    long page_size = sysconf(_SC_PAGESIZE);
+    char *base;
+
+    // Unmap the stack left behind by a process that released its own stack
+    if (DeadStack != NULL) {
+        munmap(DeadStack - page_size, DeadStackSize + page_size);
+        DeadStack = NULL;
+    }
+
+    // Reuse a free stack of the same size class if there is one
+    if (size_class <= STACK_CLASSES && StackPool[size_class].num_free > 0) {
+        StackPool[size_class].num_free--;
+        return StackPool[size_class].free_stacks[StackPool[size_class].num_free];
+    }
+
+    base = mmap(NULL, size + page_size, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANON | MAP_NORESERVE, -1, 0);
+    if (base == MAP_FAILED) {
+        return NULL;
+    }
+
+    // Stacks grow down, so the guard page sits at the lowest address
+    if (mprotect(base, page_size, PROT_NONE) != 0) {
+        munmap(base, size + page_size);
+        return NULL;
+    }
+
+    return base + page_size;
+} /* stack_alloc */
+
+/*---------------------------- stack_free -----------------------
+|  Function stack_free
+|
+|  Purpose:  Returns a stack from stack_alloc to the pool for its size
+|            class, giving its pages back to the kernel so a deep
+|            recursion doesn't stay resident. Stacks too large to pool,
+|            or that don't fit in a full pool, are unmapped.
+|
+|  Parameters:
+|      stack (IN) --  The stack returned by stack_alloc
+|      size (IN) --  The size the stack was allocated with
+|
+|  Returns:  void
+|
+|  Side Effects: A stack still in use by Current (a quitting process
+|                cleaning up its own slot) is unmapped later instead
+*-------------------------------------------------------------------*/
+void stack_free(char *stack, unsigned int size) {
+    int size_class = size / USLOSS_MIN_STACK;
+    long page_size = sysconf(_SC_PAGESIZE);
+
+    // The pooled stack stays mapped, so it is safe to pool even if Current
+    // is still running on it, as long as the pages from a page below its
+    // frame up are kept
+    if (size_class <= STACK_CLASSES && StackPool[size_class].num_free < num_proc_slots) {
+        char *used_end = stack + size;
+        char here;
+
+        if (Current != NULL && stack == Current->cold->stack) {
+            used_end = (char *) (((unsigned long) &here & ~(page_size - 1)) -
+                                 page_size);
+        }
+        if (used_end > stack) {
+            madvise(stack, used_end - stack, MADV_DONTNEED);
+        }
+        StackPool[size_class].free_stacks[StackPool[size_class].num_free] = stack;
+        StackPool[size_class].num_free++;
+        return;
+    }
+
+    if (Current != NULL && stack == Current->cold->stack) {
+        if (DeadStack != NULL) {
+            munmap(DeadStack - page_size, DeadStackSize + page_size);
+        }
+        DeadStack = stack;
+        DeadStackSize = size;
+        return;
+    }
+
+    munmap(stack - page_size, size + page_size);
+} /* stack_free */
+
 /*---------------------------- dump_processes -----------------------
 |  Function dump_processes
 |
@@ -1029,21 +1514,15 @@ void dump_processes() {
     console("\n     PID       Name      Priority     Status     Parent     CPU Time    Child Count\n");
 
     int i;
-    for(i = 0; i < MAXPROC; i++){
+    for(i = next_used_slot(0); i >= 0; i = next_used_slot(i + 1)){
         char buf[30];
         char *status = buf;
         char *parent;
 
-        // Calculate the CPU time of the process
-        int run_time;
-        if (Current->pid == ProcTable[i].pid) {
-            // This process is the current process, we can calculate its CPU time
-            run_time = sys_clock() - read_cur_start_time();
-        } else {
-            run_time = ProcTable[i].start_time;
-        }
-
         if(ProcTable[i].status != EMPTY){
+           // Bring the CPU time of a running process up to now
+           charge_proc_time(&ProcTable[i]);
+
            switch(ProcTable[i].status) {
                case READY : status = ready;
                    break;
@@ -1061,7 +1540,7 @@ void dump_processes() {
            }
 
            if(ProcTable[i].parent_ptr != NULL){
-               parent = ProcTable[i].parent_ptr->name;
+               parent = ProcTable[i].parent_ptr->cold->name;
            } else {
                parent = "NULL";
            }
@@ -1077,7 +1556,7 @@ void dump_processes() {
 		   }
 
            // Display process iteration information
-           console("%8d %10s %10d %13s %10s %10d %10d\n", ProcTable[i].pid, ProcTable[i].name, ProcTable[i].priority, status, parent, run_time, child_count);
+           console("%8d %10s %10d %13s %10s %10d %10d\n", ProcTable[i].pid, ProcTable[i].cold->name, ProcTable[i].priority, status, parent, ProcTable[i].cpu_time, child_count);
         }
     }
 }/* dump_processes */
@@ -1096,27 +1575,34 @@ void dump_processes() {
 |  Side Effects:  Process is removed from parent's childList
 *-------------------------------------------------------------------*/
 void remove_from_child_list(proc_ptr process) {
-    proc_ptr temp = process;
-    // process is at the head of the linked list
-    if (process == process->parent_ptr->child_proc_ptr) {
-        process->parent_ptr->child_proc_ptr = process->next_sibling_ptr;
-    } else { // process is in the middle or end of linked list
-        temp = process->parent_ptr->child_proc_ptr;
-        while (temp->next_sibling_ptr != process) {
-            temp = temp->next_sibling_ptr;
-        }
-        temp->next_sibling_ptr = temp->next_sibling_ptr->next_sibling_ptr;
+    proc_ptr parent = process->parent_ptr;
+
+    // Unlink from the sibling before and after, updating the parent's
+    // head or tail when process is first or last
+    if (process->prev_sibling_ptr == NULL) {
+        parent->child_proc_ptr = process->next_sibling_ptr;
+    } else {
+        process->prev_sibling_ptr->next_sibling_ptr = process->next_sibling_ptr;
+    }
+    if (process->next_sibling_ptr == NULL) {
+        parent->child_tail_ptr = process->prev_sibling_ptr;
+    } else {
+        process->next_sibling_ptr->prev_sibling_ptr = process->prev_sibling_ptr;
     }
+    process->next_sibling_ptr = NULL;
+    process->prev_sibling_ptr = NULL;
+
     if (DEBUG && debugflag) {
        console("remove_from_child_list(): Process %d removed.\n",
-                      temp->pid);
+                      process->pid);
     }
 }/* remove_from_child_list */
 
 /*------------------------------------------------------------------
 |  Function remove_from_quit_list
 |
-|  Purpose: Removes process from parent's quit list
+|  Purpose: Removes process from parent's quit list. Children are always
+|           reaped in quit order, so process is the head of the list.
 |
 |  Parameters:
 |            proc_ptr process, process to be removed
@@ -1127,6 +1613,10 @@ void remove_from_child_list(proc_ptr process) {
 *-------------------------------------------------------------------*/
 void remove_from_quit_list(proc_ptr process) {
     process->parent_ptr->quit_child_ptr = process->next_quit_sibling;
+    if (process->next_quit_sibling == NULL) {
+        process->parent_ptr->quit_child_tail = NULL;
+    }
+    process->next_quit_sibling = NULL;
 
     if (DEBUG && debugflag) {
        console("remove_from_quit_list(): Process %d removed.\n",
@@ -1135,7 +1625,9 @@ void remove_from_quit_list(proc_ptr process) {
 }/* remove_from_quit_list */
 
 void clock_handler() {
+    interrupt_enter();
     time_slice();
+    interrupt_exit();
 }
 
 /*------------------------------------------------------------------
@@ -1151,16 +1643,12 @@ void clock_handler() {
 |  Side Effects: the process is added back of the quit child list
 *-------------------------------------------------------------------*/
 void add_to_quit_child_list(proc_ptr parent) {
-    // 
     if (parent->quit_child_ptr == NULL) {
         parent->quit_child_ptr = Current;
-        return;
+    } else {
+        parent->quit_child_tail->next_quit_sibling = Current;
     }
-    proc_ptr child = parent->quit_child_ptr;
-    while (child->next_quit_sibling != NULL) {
-        child = child->next_quit_sibling;
-    }
-    child->next_quit_sibling = Current;
+    parent->quit_child_tail = Current;
 }/* add_to_quit_child_list */
 
 /*
@@ -1170,6 +1658,157 @@ int getpid(){
     return Current->pid;
 }
 
+/*
+ * Returns the number of dispatches that switched to another process and
+ * the number that kept the running process
+ */
+void read_switch_counts(int *switches, int *no_switches) {
+    *switches = switch_count;
+    *no_switches = no_switch_count;
+}
+
+/*------------------------------------------------------------------
+|  Function charge_proc_time
+|
+|  Purpose:  Charges the time since the process entered its current
+|            status to the matching usage counter. Running time spent
+|            inside an interrupt handler is also counted as interrupt time.
+|
+|  Parameters:
+|            proc_ptr proc - the process to charge
+|
+|  Returns:  void
+|
+|  Side Effects:  The process usage counters and state_time are updated
+*-------------------------------------------------------------------*/
+void charge_proc_time(proc_ptr proc) {
+    int now = sys_clock();
+    int elapsed = now - proc->state_time;
+
+    if (proc->state_time < 0) {
+        elapsed = 0;
+    }
+
+    switch (proc->status) {
+        case RUNNING:
+            proc->cpu_time += elapsed;
+            if (proc->in_interrupt > 0) {
+                proc->int_time += elapsed;
+            }
+            break;
+        case READY:
+            proc->ready_time += elapsed;
+            break;
+        case QUIT:
+        case EMPTY:
+            break;
+        default:
+            // JOIN_BLOCKED, ZAP_BLOCKED and the block_me statuses
+            proc->blocked_time += elapsed;
+    }
+
+    proc->state_time = now;
+} /* charge_proc_time */
+
+/*------------------------------------------------------------------
+|  Function set_proc_status
+|
+|  Purpose:  Changes the status of a process, charging the time spent
+|            in the old status first
+|
+|  Parameters:
+|            proc_ptr proc - the process to change
+|            int status - the new status
+|
+|  Returns:  void
+*-------------------------------------------------------------------*/
+void set_proc_status(proc_ptr proc, int status) {
+    charge_proc_time(proc);
+    count_status(proc->status, -1);
+    proc->status = status;
+    count_status(status, 1);
+} /* set_proc_status */
+
+/*------------------------------------------------------------------
+|  Function count_status
+|
+|  Purpose:  Adjusts the live runnable/blocked process counts for a
+|            process entering (1) or leaving (-1) a status
+|
+|  Parameters:
+|            int status - the status entered or left
+|            int delta - 1 or -1
+|
+|  Returns:  void
+*-------------------------------------------------------------------*/
+void count_status(int status, int delta) {
+    switch (status) {
+        case READY:
+        case RUNNING:
+            num_runnable += delta;
+            break;
+        case QUIT:
+        case EMPTY:
+            break;
+        default:
+            // JOIN_BLOCKED, ZAP_BLOCKED and the block_me statuses
+            if (status > 0) {
+                num_blocked += delta;
+            }
+    }
+} /* count_status */
+
+/*------------------------------------------------------------------
+|  Function get_proc_usage
+|
+|  Purpose:  Reports the cumulative CPU usage of a process
+|
+|  Parameters:
+|            int pid - the process to report on
+|            proc_usage *usage - where to store the usage
+|
+|  Returns:  int - 0 on success, -1 if no such process exists
+*-------------------------------------------------------------------*/
+int get_proc_usage(int pid, proc_usage *usage) {
+    proc_ptr proc = pid_to_proc(pid);
+
+    if (proc == NULL || proc->status == EMPTY) {
+        return -1;
+    }
+
+    charge_proc_time(proc);
+
+    usage->cpu_time = proc->cpu_time;
+    usage->ready_time = proc->ready_time;
+    usage->blocked_time = proc->blocked_time;
+    usage->int_time = proc->int_time;
+    usage->vol_switches = proc->vol_switches;
+    usage->invol_switches = proc->invol_switches;
+    return 0;
+} /* get_proc_usage */
+
+/*
+ * Marks the start of an interrupt handler, the running time of the
+ * Current process is charged as interrupt time until interrupt_exit
+ */
+void interrupt_enter() {
+    if (Current != NULL) {
+        charge_proc_time(Current);
+        Current->in_interrupt++;
+        trace_event(TRACE_INTERRUPT, Current->pid, Current->in_interrupt);
+    }
+}
+
+/*
+ * Marks the end of an interrupt handler started by interrupt_enter
+ */
+void interrupt_exit() {
+    if (Current != NULL && Current->in_interrupt > 0) {
+        charge_proc_time(Current);
+        Current->in_interrupt--;
+    }
+}
+
 /*
  * Returns the start time of the current process
  */
@@ -1181,14 +1820,61 @@ int read_cur_start_time() {
  * Calls dispatcher if a process has been time sliced
  * If the time allowed for each process has been past,
  * call the dispatcher to determine if another process should run.
+ * In tickless mode a process alone on its level is not checked, fork1
+ * and unblock_proc already dispatch any higher priority process and
+ * there is no process at its level to rotate to. Under SCHED_STRIDE
+ * the other levels compete for the CPU too, so every tick is checked.
+ * Under SCHED_MLFQ a process that uses up its time slice sinks a level,
+ * and every MLFQ_AGING microseconds all processes return to the level
+ * of their priority.
 */
 void time_slice() {
-    if (readtime() >= TIME_SLICE) {
+    if (sched_policy == SCHED_MLFQ && sys_clock() - last_aging >= MLFQ_AGING) {
+        age_processes();
+    }
+    if (tickless_sched && sched_policy == SCHED_PRIORITY &&
+            ReadyList[Current->level].head == Current &&
+            ReadyList[Current->level].tail == Current) {
+        skipped_ticks++;
+        return;
+    }
+    if (readtime() >= TimeSlice[Current->level]) {
+        if (sched_policy == SCHED_MLFQ && Current->level < MINPRIORITY) {
+            set_level(Current, Current->level + 1);
+        }
         dispatcher();
     }
     return;
 }
 
+/*
+ * Sets the time slice, in microseconds, for processes of the given
+ * priority. Returns -1 if the priority or time slice is invalid.
+ */
+int set_time_slice(int priority, int slice) {
+    if( (PSR_CURRENT_MODE & psr_get()) == 0 ) {
+        console("set_time_slice(): called while in user mode, by process %d. Halting...\n", Current->pid);
+        halt(1);
+    }
+
+    if (priority < MAXPRIORITY || priority > SENTINELPRIORITY || slice <= 0) {
+        return -1;
+    }
+    TimeSlice[priority] = slice;
+    return 0;
+}
+
+/*
+ * Turns the tickless scheduler mode on (non-zero) or off
+ */
+void set_tickless(int on) {
+    if( (PSR_CURRENT_MODE & psr_get()) == 0 ) {
+        console("set_tickless(): called while in user mode, by process %d. Halting...\n", Current->pid);
+        halt(1);
+    }
+    tickless_sched = on;
+}
+
 /*
  * Returns the difference between the current process's start time and
  * the USLOSS clock
@@ -1218,7 +1904,7 @@ int block_me(int new_status) {
 
     // Debug info
     if (DEBUG && debugflag) {
-        console("block_me(): Process %s is disabling interrupts.\n", Current->name);
+        console("block_me(): Process %s is disabling interrupts.\n", Current->cold->name);
     }
 
     // Disable interrupts
@@ -1230,19 +1916,12 @@ int block_me(int new_status) {
         halt(1);
     }
 
-    // Set current process status to the new value specified by the argument
-    Current->status = new_status;
-
-    // Remove the current process from the Ready List
-    // This process will now be waiting for some event to happen before being unblocked
-    remove_from_ready_list(Current);
-
-    // Call the dispatcher to set the new process
-    dispatcher();
+    // Block on no wait queue, unblock_proc wakes this process by pid
+    block_on(NULL, new_status);
     
     // Debug info
     if (DEBUG && debugflag) {
-        console("block_me(): Process %s is unblocked.\n", Current->name);
+        console("block_me(): Process %s is unblocked.\n", Current->cold->name);
     }
 
     // Check for zapped condition
@@ -1268,38 +1947,109 @@ int block_me(int new_status) {
 |  Side Effects:  Process status is changed, added back to readyList
 *-------------------------------------------------------------------*/
 int unblock_proc(int pid){
+    proc_ptr proc = pid_to_proc(pid);
+    int critical = in_critical_section();
+
     // Verify given PID is valid, and is potentially blocked
-    if (ProcTable[pid % MAXPROC].pid != pid) {
+    if (proc == NULL) {
         return -2;
     }
     if (Current->pid == pid) {
         return -2;
     }
-    if (ProcTable[pid % MAXPROC].status < 11) {
+    if (proc->status < 11) {
         return -2;
     }
     if (is_zapped()) {
         return -1;
     }
 
-    // Change status of the given PID back to 'READY'
-    ProcTable[pid % MAXPROC].status = READY;
-
-    // Add the process back to the Ready List
-    add_proc_to_ready_list(&ProcTable[pid % MAXPROC]);
+    // Change status of the given PID back to 'READY', taking it off any
+    // wait queue, and add it back to the Ready List
+    wake_proc(proc);
     
-    // Call the dispatcher to set the new process
-    dispatcher();
+    // Call the dispatcher to set the new process, or once the caller
+    // leaves its critical section
+    wakeup_dispatch(critical);
 
     // Success
     return 0;
 }/* unblock_proc */
 
+/*------------------------------------------------------------------
+|  Function handoff_proc
+|
+|  Purpose:  Unblocks a process, as unblock_proc does, and runs it at
+|            once when it is a ready process of the highest level and
+|            no lower a level than the caller. The caller stays READY
+|            in its place on the ready list, and the woken process starts
+|            a new time slice, so a process that wakes its peer and is
+|            about to wait for its reply doesn't keep the CPU until then.
+|            Under SCHED_STRIDE or when the process must wait its turn,
+|            it is an ordinary unblock_proc.
+|
+|  Parameters:
+|            int pid - the pid of the process to unblock
+|
+|  Returns:  int - the return code, as for unblock_proc
+|
+|  Side Effects:  Process status is changed, added back to readyList,
+|                 the caller may be switched out
+*-------------------------------------------------------------------*/
+int handoff_proc(int pid) {
+    proc_ptr proc = pid_to_proc(pid);
+    int critical = in_critical_section();
+    proc_ptr old = Current;
+
+    if( (PSR_CURRENT_MODE & psr_get()) == 0 ) {
+        console("handoff_proc(): called while in user mode, by process %d. Halting...\n", Current->pid);
+        halt(1);
+    }
+    disableInterrupts();
+
+    // Verify given PID is valid, and is potentially blocked
+    if (proc == NULL || Current->pid == pid || proc->status < 11) {
+        if (!critical) {
+            enableInterrupts();
+        }
+        return -2;
+    }
+    if (is_zapped()) {
+        if (!critical) {
+            enableInterrupts();
+        }
+        return -1;
+    }
+
+    wake_proc(proc);
+
+    // The bitmap says whether anything outranks it, no ready list scan
+    if (sched_policy == SCHED_STRIDE || proc->level > old->level ||
+            ffs(ReadyBitmap) - 1 < proc->level) {
+        wakeup_dispatch(critical);
+        if (!critical) {
+            enableInterrupts();
+        }
+        return 0;
+    }
+
+    // Switch straight to it, this is the dispatch any wakeup deferred
+    // in the caller's critical section was waiting for
+    need_resched = 0;
+    set_proc_status(old, READY);
+    // The caller stays READY, but it gave the CPU away itself
+    switch_to(old, proc, 1);
+    if (critical) {
+        disableInterrupts();
+    }
+    return 0;
+} /* handoff_proc */
+
 /*------------------------------------------------------------------
 |  Function remove_from_ready_list
 |
-|  Purpose:  Finds process in ReadyList, removes process, reasigns
-|            all important processes|
+|  Purpose:  Unlinks process from the ReadyList queue for its priority.
+|            Constant time, the queue is doubly linked.
 |
 |  Parameters:
 |            proc_ptr process, process to be deleted
@@ -1309,51 +2059,447 @@ int unblock_proc(int pid){
 |  Side Effects:  Process is removed from ReadyList
 *-------------------------------------------------------------------*/
 void remove_from_ready_list(proc_ptr process) {
-    // Check if the given process IS the ReadyList variable
-    // In other words, the process to be deleted from the Ready List,
-    // is the first process in the Ready List
-    if(process == ReadyList) {
-    	// Move ready list to the next process
-        ReadyList = ReadyList->next_proc_ptr;
-    } else {
-    	// The process to be removed is not the first in the list
-	// Start at the first process in the list
-        proc_ptr proc = ReadyList;
+    ready_queue *queue = &ReadyList[process->level];
 
-	// Continuing moving down the list until we find the process to be removed from the list
-        while (proc->next_proc_ptr != process) {
-            proc = proc->next_proc_ptr;
-        }
+    // Unlink the process from its neighbours, fixing up the head and tail
+    // of the queue when the process is at either end
+    if (process->prev_proc_ptr == NULL) {
+        queue->head = process->next_proc_ptr;
+    } else {
+        process->prev_proc_ptr->next_proc_ptr = process->next_proc_ptr;
+    }
+    if (process->next_proc_ptr == NULL) {
+        queue->tail = process->prev_proc_ptr;
+    } else {
+        process->next_proc_ptr->prev_proc_ptr = process->prev_proc_ptr;
+    }
+    process->next_proc_ptr = NULL;
+    process->prev_proc_ptr = NULL;
 
-	// 'proc' is now the process located right before the process to be removed from the list
-	// Remove the target process by setting 'proc's next pointer to the process after the one to be removed
-	// We are basically setting the pointer to skip over the process we no longer want in the ready list
-        proc->next_proc_ptr = proc->next_proc_ptr->next_proc_ptr;
+    // Clear the bit for this priority level once its queue is empty
+    if (queue->head == NULL) {
+        ReadyBitmap &= ~(1 << process->level);
     }
+
     if (DEBUG && debugflag) {
         console("remove_from_ready_list(): Process %d removed from ReadyList.\n", process->pid);
     }
 }/* remove_from_ready_list */
 
 /*------------------------------------------------------------------
-|  Function unblock_zappers
+|  Function ready_list_head
+|
+|  Purpose:  Finds the first process on the highest priority non-empty
+|            ready queue using the ReadyBitmap.
 |
-|  Purpose:  Unblocks all processes that zapped a process.
+|  Parameters:  None
+|
+|  Returns:  proc_ptr - the next process to run, NULL if none are ready
+*-------------------------------------------------------------------*/
+proc_ptr ready_list_head() {
+    unsigned int levels = ReadyBitmap & ~(1 << SENTINELPRIORITY);
+    proc_ptr best = NULL;
+
+    if (ReadyBitmap == 0) {
+        return NULL;
+    }
+
+    // Under SCHED_STRIDE the lowest pass runs, each queue is in pass order
+    // so only the heads are compared. The sentinel only runs when no
+    // other process can.
+    if (sched_policy == SCHED_STRIDE && levels != 0) {
+        while (levels != 0) {
+            proc_ptr head = ReadyList[ffs(levels) - 1].head;
+
+            if (best == NULL || head->pass < best->pass) {
+                best = head;
+            }
+            levels &= levels - 1;
+        }
+        return best;
+    }
+
+    // The lowest set bit is the highest priority level with a ready process
+    return ReadyList[ffs(ReadyBitmap) - 1].head;
+}/* ready_list_head */
+
+/*------------------------------------------------------------------
+|  Function charge_stride
+|
+|  Purpose:  Advances the SCHED_STRIDE pass of a process by its stride
+|            times the fraction of its level's time slice it ran since
+|            it was dispatched, and moves it to its new place in its ready queue
 |
 |  Parameters:
-|            proc_ptr ptr - head of linked list of processes that zapped
-|                          the calling process.
+|            proc_ptr proc - the process leaving the CPU
+|
+|  Returns:  void
+*-------------------------------------------------------------------*/
+void charge_stride(proc_ptr proc) {
+    long long stride;
+
+    // A process that quit has nothing left to pay for, its slot may
+    // already be reset
+    if (proc->status == QUIT || proc->status == EMPTY ||
+            proc->priority == SENTINELPRIORITY) {
+        return;
+    }
+
+    stride = STRIDE1 / SCHED_TICKETS(proc->priority);
+    proc->pass += stride * (sys_clock() - proc->start_time) /
+                  TimeSlice[proc->level];
+
+    // The running process is on the ready list, re-add it in pass order
+    if (proc->status == RUNNING) {
+        remove_from_ready_list(proc);
+        add_proc_to_ready_list(proc);
+    }
+} /* charge_stride */
+
+/*------------------------------------------------------------------
+|  Function set_level
+|
+|  Purpose:  Moves a process to another ready queue level, keeping its
+|            place on the ready list if it is on it
+|
+|  Parameters:
+|            proc_ptr proc - the process to move
+|            int level - its new level, MAXPRIORITY to MINPRIORITY
+|
+|  Returns:  void
+*-------------------------------------------------------------------*/
+void set_level(proc_ptr proc, int level) {
+    if (proc->status == READY || proc->status == RUNNING) {
+        remove_from_ready_list(proc);
+        proc->level = level;
+        add_proc_to_ready_list(proc);
+    } else {
+        proc->level = level;
+    }
+} /* set_level */
+
+/*------------------------------------------------------------------
+|  Function age_processes
+|
+|  Purpose:  Returns every SCHED_MLFQ process that sank below the level
+|            of its priority back to that level, so processes that used
+|            up their time slices are not starved by newer ones
+|
+|  Parameters:  None
+|
+|  Returns:  void
+*-------------------------------------------------------------------*/
+void age_processes() {
+    int slot;
+
+    for (slot = next_used_slot(0); slot >= 0; slot = next_used_slot(slot + 1)) {
+        proc_ptr proc = &ProcTable[slot];
+
+        if (proc->level > proc->priority) {
+            set_level(proc, proc->priority);
+        }
+    }
+    last_aging = sys_clock();
+} /* age_processes */
+
+/*------------------------------------------------------------------
+|  Function sched_init
+|
+|  Purpose:  Sets the scheduling policy from the PHASE1_SCHED environment
+|            variable, "priority" (the default), "stride" or "mlfq"
+|
+|  Parameters:  None
+|
+|  Returns:  void
+|
+|  Side Effects:  halts USLOSS if the policy is unknown
+*-------------------------------------------------------------------*/
+void sched_init() {
+    char *value = getenv("PHASE1_SCHED");
+
+    if (value == NULL || value[0] == '\0' || strcmp(value, "priority") == 0) {
+        sched_policy = SCHED_PRIORITY;
+    } else if (strcmp(value, "stride") == 0) {
+        sched_policy = SCHED_STRIDE;
+    } else if (strcmp(value, "mlfq") == 0) {
+        sched_policy = SCHED_MLFQ;
+    } else {
+        console("startup(): unknown PHASE1_SCHED policy %s.  Halting...\n", value);
+        halt(1);
+    }
+} /* sched_init */
+
+/*------------------------------------------------------------------
+|  Function in_critical_section
+|
+|  Purpose:  Tells whether the caller has interrupts disabled, i.e. is
+|            part way through a kernel operation
+|
+|  Parameters:  None
+|
+|  Returns:  int - 1 if interrupts are disabled, 0 otherwise
+*-------------------------------------------------------------------*/
+int in_critical_section() {
+    return (psr_get() & PSR_CURRENT_INT) == 0;
+} /* in_critical_section */
+
+/*------------------------------------------------------------------
+|  Function wakeup_dispatch
+|
+|  Purpose:  Reschedules after processes have been woken, if one of
+|            them outranks the running process. Inside a critical
+|            section nothing is done yet, so that every wakeup of the
+|            operation is handled by one dispatch when enableInterrupts
+|            ends it.
+|
+|  Parameters:
+|            int critical - whether the waker was in a critical section
+|
+|  Returns:  void
+*-------------------------------------------------------------------*/
+void wakeup_dispatch(int critical) {
+    if (!critical) {
+        resched();
+    }
+} /* wakeup_dispatch */
+
+/*------------------------------------------------------------------
+|  Function resched
+|
+|  Purpose:  Runs the dispatcher if a wakeup was deferred. Called when
+|            leaving a critical section.
+|
+|  Parameters:  None
+|
+|  Returns:  void
+*-------------------------------------------------------------------*/
+void resched() {
+    if (need_resched && Current != NULL) {
+        dispatcher();
+    }
+} /* resched */
+
+/*------------------------------------------------------------------
+|  Function wait_queue_init
+|
+|  Purpose:  Empties a wait queue
+|
+|  Parameters:
+|            wait_queue *queue - the queue to initialize
+|
+|  Returns:  void
+*-------------------------------------------------------------------*/
+void wait_queue_init(wait_queue *queue) {
+    queue->head = NULL;
+    queue->tail = NULL;
+} /* wait_queue_init */
+
+/*------------------------------------------------------------------
+|  Function block_on
+|
+|  Purpose:  Blocks the Current process with the given status at the
+|            tail of a wait queue, and dispatches another process
+|
+|  Parameters:
+|            wait_queue *queue - the queue to wait on, NULL to wait
+|                                only for unblock_proc
+|            int status - the blocked status
+|
+|  Returns:  void, once the process has been woken
+|
+|  Side Effects:  Process status is changed, removed from readyList
+*-------------------------------------------------------------------*/
+void block_on(wait_queue *queue, int status) {
+    trace_event(TRACE_BLOCK, Current->pid, status);
+    set_proc_status(Current, status);
+    remove_from_ready_list(Current);
+
+    if (queue != NULL) {
+        Current->waiting_on = queue;
+        Current->prev_waiting = queue->tail;
+        if (queue->tail == NULL) {
+            queue->head = Current;
+        } else {
+            queue->tail->next_waiting = Current;
+        }
+        queue->tail = Current;
+    }
+
+    dispatcher();
+} /* block_on */
+
+/*------------------------------------------------------------------
+|  Function wake_proc
+|
+|  Purpose:  Makes a blocked process READY, unlinking it from the wait
+|            queue it is on. Does not dispatch.
+|
+|  Parameters:
+|            proc_ptr proc - the process to wake
 |
 |  Returns:  void
 |
 |  Side Effects:  Process status is set to READY and process is added
 |                 to the ready list.
 *-------------------------------------------------------------------*/
-void unblock_zappers(proc_ptr ptr) {
-    if (ptr == NULL) {
-        return;
+void wake_proc(proc_ptr proc) {
+    wait_queue *queue = proc->waiting_on;
+
+    if (queue != NULL) {
+        if (proc->prev_waiting == NULL) {
+            queue->head = proc->next_waiting;
+        } else {
+            proc->prev_waiting->next_waiting = proc->next_waiting;
+        }
+        if (proc->next_waiting == NULL) {
+            queue->tail = proc->prev_waiting;
+        } else {
+            proc->next_waiting->prev_waiting = proc->prev_waiting;
+        }
+        proc->next_waiting = NULL;
+        proc->prev_waiting = NULL;
+        proc->waiting_on = NULL;
+    }
+
+    // Under SCHED_MLFQ a process back from block_me or a wait queue, i.e.
+    // from I/O or a message, runs a level above its priority until it
+    // next uses up a time slice
+    if (sched_policy == SCHED_MLFQ && proc->status > ZAP_BLOCKED) {
+        proc->level = proc->priority > MAXPRIORITY ? proc->priority - 1 : MAXPRIORITY;
+    }
+
+    trace_event(TRACE_UNBLOCK, proc->pid, Current == NULL ? 0 : Current->pid);
+    set_proc_status(proc, READY);
+    add_proc_to_ready_list(proc);
+
+    // A process of an equal or lower level waits for its turn
+    if (Current == NULL || proc->level < Current->level) {
+        need_resched = 1;
+    }
+} /* wake_proc */
+
+/*------------------------------------------------------------------
+|  Function wake_waiters
+|
+|  Purpose:  Wakes up to max processes from the head of a wait queue,
+|            in the order they blocked. Does not dispatch, so the
+|            caller can reschedule once for all of them.
+|
+|  Parameters:
+|            wait_queue *queue - the queue to wake
+|            int max - the most processes to wake
+|
+|  Returns:  int - the number of processes woken
+*-------------------------------------------------------------------*/
+int wake_waiters(wait_queue *queue, int max) {
+    int woken = 0;
+
+    while (queue->head != NULL && woken < max) {
+        wake_proc(queue->head);
+        woken++;
+    }
+    return woken;
+} /* wake_waiters */
+
+/*------------------------------------------------------------------
+|  Function wait_queue_wait
+|
+|  Purpose:  Blocks the Current process on a wait queue until it is
+|            woken by wait_queue_wake_one, wait_queue_wake_all or
+|            unblock_proc
+|
+|  Parameters:
+|            wait_queue *queue - the queue to wait on
+|            int block_status - the status to block with, as for block_me
+|
+|  Returns:  int - -1 if the process was zapped while blocked, 0 otherwise
+*-------------------------------------------------------------------*/
+int wait_queue_wait(wait_queue *queue, int block_status) {
+    if( (PSR_CURRENT_MODE & psr_get()) == 0 ) {
+        console("wait_queue_wait(): called while in user mode, by process %d. Halting...\n", Current->pid);
+        halt(1);
+    }
+    disableInterrupts();
+
+    if (block_status < 11) {
+        console("wait_queue_wait(): called with invalid status of %d. Halting...\n", block_status);
+        halt(1);
+    }
+
+    block_on(queue, block_status);
+
+    if (is_zapped()) {
+        return -1;
+    }
+    return 0;
+} /* wait_queue_wait */
+
+/*------------------------------------------------------------------
+|  Function wait_queue_wake_one
+|
+|  Purpose:  Wakes the process that has waited longest on a wait queue.
+|            Called inside a critical section, the dispatch is deferred
+|            until it is left.
+|
+|  Parameters:
+|            wait_queue *queue - the queue to wake
+|
+|  Returns:  int - the number of processes woken, 0 or 1
+|
+|  Side Effects:  the dispatcher runs if a process was woken
+*-------------------------------------------------------------------*/
+int wait_queue_wake_one(wait_queue *queue) {
+    int critical = in_critical_section();
+
+    if( (PSR_CURRENT_MODE & psr_get()) == 0 ) {
+        console("wait_queue_wake_one(): called while in user mode, by process %d. Halting...\n", Current->pid);
+        halt(1);
+    }
+    disableInterrupts();
+
+    if (wake_waiters(queue, 1) == 0) {
+        if (!critical) {
+            enableInterrupts();
+        }
+        return 0;
+    }
+    wakeup_dispatch(critical);
+    if (!critical) {
+        enableInterrupts();
+    }
+    return 1;
+} /* wait_queue_wake_one */
+
+/*------------------------------------------------------------------
+|  Function wait_queue_wake_all
+|
+|  Purpose:  Wakes every process on a wait queue, then runs the
+|            dispatcher once for all of them (deferred, as for
+|            wait_queue_wake_one, inside a critical section)
+|
+|  Parameters:
+|            wait_queue *queue - the queue to wake
+|
+|  Returns:  int - the number of processes woken
+|
+|  Side Effects:  the dispatcher runs if any process was woken
+*-------------------------------------------------------------------*/
+int wait_queue_wake_all(wait_queue *queue) {
+    int critical = in_critical_section();
+    int woken;
+
+    if( (PSR_CURRENT_MODE & psr_get()) == 0 ) {
+        console("wait_queue_wake_all(): called while in user mode, by process %d. Halting...\n", Current->pid);
+        halt(1);
+    }
+    disableInterrupts();
+
+    woken = wake_waiters(queue, num_proc_slots);
+    if (woken > 0) {
+        wakeup_dispatch(critical);
+    }
+    if (!critical) {
+        enableInterrupts();
     }
-    unblock_zappers(ptr->next_who_zapped);
-    ptr->status = READY;
-    add_proc_to_ready_list(ptr);
-} /* unblock_zappers */
+    return woken;
+} /* wait_queue_wake_all */
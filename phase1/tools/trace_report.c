@@ -0,0 +1,231 @@
+/* ------------------------------------------------------------------------
+   trace_report.c
+
+   Offline report of a phase 1 scheduler trace, the file written at halt()
+   when PHASE1_TRACE is set. Prints run-queue latency (ready until
+   switched to), slice lengths (switched to until switched from) and the
+   CPU utilization of each process.
+
+   Usage: trace_report <trace file>
+   ------------------------------------------------------------------------ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <phase1.h>
+#include "trace.h"
+
+/* What the report knows about one pid */
+typedef struct pid_stats {
+    int seen;
+    int ready_since;        /* time it became ready, -1 if not waiting */
+    int running_since;      /* time it was switched to, -1 if not running */
+    int stopped;            /* blocked or quit since it was switched to */
+    long run_time;
+    int slices;
+    long latency_total;
+    int latencies;
+    int interrupts;
+} pid_stats;
+
+/* A growable list of samples for percentiles */
+typedef struct samples {
+    int *values;
+    int count;
+    int size;
+} samples;
+
+static pid_stats *Pids;
+static int num_pids = 0;
+
+pid_stats *get_pid(int pid);
+void add_sample(samples *list, int value);
+int compare_ints(const void *a, const void *b);
+void print_distribution(char *name, samples *list);
+
+int main(int argc, char *argv[]) {
+    trace_header header;
+    trace_record record;
+    samples latency = {NULL, 0, 0};
+    samples slice = {NULL, 0, 0};
+    int first_time = -1, last_time = 0;
+    int current = -1;
+    long span;
+    FILE *file;
+    int i;
+
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s <trace file>\n", argv[0]);
+        return 1;
+    }
+    file = fopen(argv[1], "rb");
+    if (file == NULL) {
+        perror(argv[1]);
+        return 1;
+    }
+    if (fread(&header, sizeof(header), 1, file) != 1 ||
+            memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic)) != 0) {
+        fprintf(stderr, "%s: not a phase 1 trace\n", argv[1]);
+        return 1;
+    }
+
+    for (i = 0; i < header.count; i++) {
+        pid_stats *proc;
+        pid_stats *old;
+
+        if (fread(&record, sizeof(record), 1, file) != 1) {
+            fprintf(stderr, "%s: truncated after %d records\n", argv[1], i);
+            break;
+        }
+        if (first_time < 0) {
+            first_time = record.time;
+        }
+        last_time = record.time;
+        proc = get_pid(record.pid);
+
+        switch (record.type) {
+            case TRACE_FORK:
+            case TRACE_UNBLOCK:
+                proc->ready_since = record.time;
+                break;
+            case TRACE_BLOCK:
+            case TRACE_QUIT:
+                proc->stopped = 1;
+                break;
+            case TRACE_INTERRUPT:
+                proc->interrupts++;
+                break;
+            case TRACE_SWITCH:
+                // End the slice of the process switched from, it is ready
+                // again unless it blocked or quit. A process that quit
+                // without a parent is switched from as pid -1.
+                old = get_pid(record.arg);
+                if (old->running_since >= 0) {
+                    old->run_time += record.time - old->running_since;
+                    old->slices++;
+                    add_sample(&slice, record.time - old->running_since);
+                } else if (current < 0) {
+                    // Running since before the oldest record
+                    old->run_time += record.time - first_time;
+                }
+                old->running_since = -1;
+                old->ready_since = old->stopped ? -1 : record.time;
+                old->stopped = 0;
+
+                // Start the slice of the process switched to
+                proc = get_pid(record.pid);
+                if (proc->ready_since >= 0) {
+                    add_sample(&latency, record.time - proc->ready_since);
+                    proc->latency_total += record.time - proc->ready_since;
+                    proc->latencies++;
+                }
+                proc->ready_since = -1;
+                proc->running_since = record.time;
+                proc->stopped = 0;
+                current = record.pid;
+                break;
+            default:
+                fprintf(stderr, "record %d: unknown type %d\n", i, record.type);
+        }
+    }
+    fclose(file);
+
+    // The last process is still running at the end of the trace
+    if (current >= 0 && Pids[current].running_since >= 0) {
+        Pids[current].run_time += last_time - Pids[current].running_since;
+    }
+
+    span = last_time - first_time;
+    printf("records %d, dropped %d, span %ld us\n\n", header.count,
+           header.dropped, span);
+    print_distribution("run-queue latency", &latency);
+    print_distribution("slice length", &slice);
+
+    printf("\n     PID   CPU (us)   Util %%   Slices  Avg slice  Avg latency  Interrupts\n");
+    for (i = 1; i < num_pids; i++) {
+        pid_stats *proc = &Pids[i];
+
+        if (!proc->seen) {
+            continue;
+        }
+        printf("%8d %10ld %8.1f %8d %10ld %12ld %11d\n", i, proc->run_time,
+               span > 0 ? 100.0 * proc->run_time / span : 0.0, proc->slices,
+               proc->slices > 0 ? proc->run_time / proc->slices : 0,
+               proc->latencies > 0 ? proc->latency_total / proc->latencies : 0,
+               proc->interrupts);
+    }
+    return 0;
+} /* main */
+
+/*
+ * Returns the stats of a pid, growing the table to hold it
+ */
+pid_stats *get_pid(int pid) {
+    // Unknown pids are counted under pid 0, which is never used
+    if (pid < 0) {
+        pid = 0;
+    }
+    if (pid >= num_pids) {
+        int size = num_pids == 0 ? 64 : num_pids;
+        int i;
+
+        while (size <= pid) {
+            size *= 2;
+        }
+        Pids = realloc(Pids, size * sizeof(pid_stats));
+        if (Pids == NULL) {
+            fprintf(stderr, "out of memory\n");
+            exit(1);
+        }
+        for (i = num_pids; i < size; i++) {
+            memset(&Pids[i], 0, sizeof(pid_stats));
+            Pids[i].ready_since = -1;
+            Pids[i].running_since = -1;
+        }
+        num_pids = size;
+    }
+    Pids[pid].seen = 1;
+    return &Pids[pid];
+} /* get_pid */
+
+/*
+ * Appends a value to a sample list
+ */
+void add_sample(samples *list, int value) {
+    if (list->count == list->size) {
+        list->size = list->size == 0 ? 1024 : 2 * list->size;
+        list->values = realloc(list->values, list->size * sizeof(int));
+        if (list->values == NULL) {
+            fprintf(stderr, "out of memory\n");
+            exit(1);
+        }
+    }
+    list->values[list->count++] = value;
+} /* add_sample */
+
+int compare_ints(const void *a, const void *b) {
+    return *(const int *) a - *(const int *) b;
+}
+
+/*
+ * Prints the count, mean and percentiles of a sample list
+ */
+void print_distribution(char *name, samples *list) {
+    long total = 0;
+    int i;
+
+    if (list->count == 0) {
+        printf("%-18s  no samples\n", name);
+        return;
+    }
+    qsort(list->values, list->count, sizeof(int), compare_ints);
+    for (i = 0; i < list->count; i++) {
+        total += list->values[i];
+    }
+    printf("%-18s  n %d  mean %ld  p50 %d  p90 %d  p99 %d  max %d us\n", name,
+           list->count, total / list->count,
+           list->values[list->count / 2],
+           list->values[(int) (list->count * 0.90)],
+           list->values[(int) (list->count * 0.99)],
+           list->values[list->count - 1]);
+} /* print_distribution */
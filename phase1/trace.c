@@ -0,0 +1,125 @@
+/* ------------------------------------------------------------------------
+   trace.c
+
+   Scheduler event trace for phase 1. Events are kept in a fixed-size
+   ring and written to the file named by the PHASE1_TRACE environment
+   variable when USLOSS halts. Without PHASE1_TRACE nothing is recorded.
+   ------------------------------------------------------------------------ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <phase1.h>
+#include "trace.h"
+
+/* -------------------------- Globals ------------------------------------- */
+
+// Set by trace_init when a trace file was asked for
+int trace_enabled = 0;
+
+// The ring, record 'n' is stored at TraceRing[n % TRACE_RING_SIZE]
+static trace_record TraceRing[TRACE_RING_SIZE];
+static unsigned int trace_count = 0;
+
+// File the ring is dumped to
+static char *trace_file;
+
+static void trace_dump(void);
+
+/* -------------------------- Functions ----------------------------------- */
+
+/*------------------------------------------------------------------
+|  Function trace_init
+|
+|  Purpose:  Turns tracing on if PHASE1_TRACE names a file, and arranges
+|            for the ring to be written there when USLOSS halts
+|
+|  Parameters:  None
+|
+|  Returns:  void
+*-------------------------------------------------------------------*/
+void trace_init() {
+    trace_file = getenv("PHASE1_TRACE");
+    if (trace_file == NULL || trace_file[0] == '\0') {
+        return;
+    }
+    trace_enabled = 1;
+
+    // halt() leaves USLOSS through exit()
+    atexit(trace_dump);
+} /* trace_init */
+
+/*------------------------------------------------------------------
+|  Function trace_event
+|
+|  Purpose:  Records one scheduler event in the ring, with interrupts
+|            off so a handler can't record into the same record
+|
+|  Parameters:
+|            int type - TRACE_FORK, TRACE_SWITCH, ...
+|            int pid - the process the event is about
+|            int arg - extra detail, see trace.h
+|
+|  Returns:  void
+*-------------------------------------------------------------------*/
+void trace_event(int type, int pid, int arg) {
+    trace_record *record;
+    unsigned int psr;
+
+    if (!trace_enabled) {
+        return;
+    }
+
+    psr = psr_get();
+    if (psr & PSR_CURRENT_INT) {
+        psr_set(psr & ~PSR_CURRENT_INT);
+    }
+
+    record = &TraceRing[trace_count & (TRACE_RING_SIZE - 1)];
+    record->time = sys_clock();
+    record->type = type;
+    record->pid = pid;
+    record->arg = arg;
+    trace_count++;
+
+    if (psr & PSR_CURRENT_INT) {
+        psr_set(psr);
+    }
+} /* trace_event */
+
+/*------------------------------------------------------------------
+|  Function trace_dump
+|
+|  Purpose:  Writes the ring to the trace file, oldest record first
+|
+|  Parameters:  None
+|
+|  Returns:  void
+*-------------------------------------------------------------------*/
+static void trace_dump(void) {
+    trace_header header;
+    unsigned int first = 0;
+    unsigned int i;
+    FILE *file;
+
+    file = fopen(trace_file, "wb");
+    if (file == NULL) {
+        fprintf(stderr, "trace_dump(): cannot open %s\n", trace_file);
+        return;
+    }
+
+    // Only the last TRACE_RING_SIZE records are still in the ring
+    if (trace_count > TRACE_RING_SIZE) {
+        first = trace_count - TRACE_RING_SIZE;
+    }
+
+    memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+    header.count = trace_count - first;
+    header.dropped = first;
+    fwrite(&header, sizeof(header), 1, file);
+
+    for (i = first; i != trace_count; i++) {
+        fwrite(&TraceRing[i & (TRACE_RING_SIZE - 1)], sizeof(trace_record), 1, file);
+    }
+    fclose(file);
+} /* trace_dump */
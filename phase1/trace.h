@@ -0,0 +1,37 @@
+#ifndef _TRACE_H
+#define _TRACE_H
+
+/* Number of records the trace ring holds, a power of two */
+#define TRACE_RING_SIZE 65536
+
+/* First bytes of a trace file */
+#define TRACE_MAGIC "P1TRACE1"
+
+/*
+ * One scheduler event, 'type' is one of the TRACE_ events in phase1.h.
+ * The meaning of 'pid' and 'arg' depends on 'type':
+ *   TRACE_FORK       pid forked,             arg 0
+ *   TRACE_SWITCH     pid switched to,        arg pid switched from
+ *   TRACE_BLOCK      pid blocked,            arg its blocked status
+ *   TRACE_UNBLOCK    pid made ready,         arg pid that woke it
+ *   TRACE_QUIT       pid quit,               arg 0
+ *   TRACE_INTERRUPT  pid interrupted,        arg handler nesting depth
+ */
+typedef struct trace_record {
+   int             time;              /* sys_clock() of the event */
+   int             type;
+   int             pid;
+   int             arg;
+} trace_record;
+
+/*
+ * A trace file is this header followed by 'count' records, oldest
+ * first. 'dropped' older records were overwritten in the ring.
+ */
+typedef struct trace_header {
+   char            magic[8];
+   int             count;
+   int             dropped;
+} trace_header;
+
+#endif /* _TRACE_H */
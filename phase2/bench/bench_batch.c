@@ -0,0 +1,106 @@
+/* Measures a two stage pipeline passing small records through a mailbox,
+ * one message per call and in batches.
+ *
+ * A producer sends TOTAL sequence numbered 8 byte records to a consumer
+ * of the same priority through a BOX_SLOTS slot mailbox.
+ *
+ * single: MboxSend and MboxReceive, one record per call
+ * batch:  MboxSendMany and MboxReceiveMany, BURST records per call
+ *
+ * The consumer checks every record arrives in order. Prints one
+ * "key=value" line per mode and burst size, times are wall clock
+ * nanoseconds per record.
+ */
+
+#include <stdio.h>
+#include <time.h>
+#include <usloss.h>
+#include <phase1.h>
+#include <phase2.h>
+
+#define TOTAL     20000
+#define BOX_SLOTS 64
+
+typedef struct record {
+  int seq;
+  int value;
+} record;
+
+int producer(char *);
+int consumer(char *);
+long now_ns(void);
+
+int box;
+int burst;
+int errors;
+
+int bursts[] = {1, 8, 32, 64};
+
+int start2(char *arg)
+{
+  int n, status;
+  long start;
+
+  box = MboxCreate(BOX_SLOTS, sizeof(record));
+
+  for (n = 0; n < sizeof(bursts) / sizeof(bursts[0]); n++) {
+    burst = bursts[n];
+    errors = 0;
+    start = now_ns();
+    fork1("consumer", consumer, NULL, USLOSS_MIN_STACK, 3);
+    fork1("producer", producer, NULL, USLOSS_MIN_STACK, 3);
+    join(&status);
+    join(&status);
+    printf("bench=batch mode=%s burst=%d records=%d ns_per_record=%ld "
+           "errors=%d\n", burst == 1 ? "single" : "batch", burst, TOTAL,
+           (now_ns() - start) / TOTAL, errors);
+  }
+
+  quit(0);
+  return 0;
+}
+
+int producer(char *arg)
+{
+  record records[64];
+  int seq, i;
+
+  for (seq = 0; seq < TOTAL; seq += burst) {
+    for (i = 0; i < burst; i++) {
+      records[i].seq = seq + i;
+      records[i].value = 2 * (seq + i);
+    }
+    if (burst == 1)
+      MboxSend(box, records, sizeof(record));
+    else
+      MboxSendMany(box, records, sizeof(record), burst);
+  }
+  quit(0);
+  return 0;
+}
+
+int consumer(char *arg)
+{
+  record records[64];
+  int next = 0, got, i;
+
+  while (next < TOTAL) {
+    if (burst == 1)
+      got = MboxReceive(box, records, sizeof(record)) < 0 ? 0 : 1;
+    else
+      got = MboxReceiveMany(box, records, sizeof(record), burst, NULL);
+    for (i = 0; i < got; i++, next++)
+      if (records[i].seq != next || records[i].value != 2 * next)
+        errors++;
+  }
+  quit(0);
+  return 0;
+}
+
+long now_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
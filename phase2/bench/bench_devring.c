@@ -0,0 +1,69 @@
+/* Measures device statuses posted in bursts, with no driver waiting.
+ *
+ * Runs the terminal interrupt handler BURST times in a row for unit 0, as
+ * a burst of interrupts would, then has the driver collect the statuses
+ * with waitdevice. Statuses that arrive while no driver is waiting are
+ * kept in the unit's ring, those that find it full are counted as
+ * overflows.
+ *
+ * Prints one "key=value" line per burst size: the statuses posted,
+ * collected without blocking and dropped, and the wall clock nanoseconds
+ * per waitdevice.
+ */
+
+#include <stdio.h>
+#include <time.h>
+#include <usloss.h>
+#include <phase1.h>
+#include <phase2.h>
+#include "message.h"
+
+extern void term_handler(int dev, long unit);
+
+long now_ns(void);
+int overflows(void);
+
+int bursts[] = {1, 4, STATUS_RING, 4 * STATUS_RING};
+
+int start2(char *arg)
+{
+  int n, i, status, burst, dropped, collected;
+  long start, ns;
+
+  for (n = 0; n < sizeof(bursts) / sizeof(bursts[0]); n++) {
+    burst = bursts[n];
+    dropped = overflows();
+    for (i = 0; i < burst; i++)
+      term_handler(TERM_DEV, 0);
+    dropped = overflows() - dropped;
+
+    collected = burst - dropped;
+    start = now_ns();
+    for (i = 0; i < collected; i++)
+      waitdevice(TERM_DEV, 0, &status);
+    ns = collected > 0 ? (now_ns() - start) / collected : 0;
+
+    printf("bench=devring burst=%d ring=%d collected=%d overflows=%d "
+           "ns_per_wait=%ld\n", burst, STATUS_RING, collected, dropped, ns);
+  }
+
+  quit(0);
+  return 0;
+}
+
+/* Statuses dropped by terminal unit 0 so far */
+int overflows(void)
+{
+  mbox_stats stats[IO_MBOXES];
+  int count = MboxGetStats(stats, IO_MBOXES);
+
+  return count > 3 ? stats[3].overflows : 0;
+}
+
+long now_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
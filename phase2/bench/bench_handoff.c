@@ -0,0 +1,136 @@
+/* Measures request/response latency with replies sent through a zero-slot
+ * mailbox, with and without the directed handoff to a blocked receiver.
+ *
+ * A client, a server and WORKERS background workers, all of the same
+ * priority. The client MboxSends a request into a one slot mailbox and
+ * MboxReceives the reply, timing the round trip, the server answers each
+ * request at once. Each worker runs for WORK_NS of wall time, then lets
+ * the next process of its priority run.
+ *
+ * plain:   a woken process joins the end of the ready queue, so both the
+ *          request and the reply wait for the workers ahead of them
+ * handoff: the reply's MboxSend switches straight to the blocked client,
+ *          only the request waits
+ *
+ * Prints one "key=value" line per mode, with the round trip percentiles
+ * in wall clock nanoseconds and context switches per round trip.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <usloss.h>
+#include <phase1.h>
+#include <phase2.h>
+
+#define ROUNDS  5000
+#define WORKERS 3
+#define WORK_NS 20000
+
+extern int handoff_enabled;
+
+int client(char *);
+int server(char *);
+int worker(char *);
+long now_ns(void);
+int compare_longs(const void *a, const void *b);
+
+int request_box, reply_box;
+long round_ns[ROUNDS];
+int done;
+
+int start2(char *arg)
+{
+  int mode, i, status, switches, no_switches, switch_start;
+
+  request_box = MboxCreate(1, sizeof(int));
+  reply_box = MboxCreate(0, sizeof(int));
+
+  for (mode = 0; mode <= 1; mode++) {
+    handoff_enabled = mode;
+    done = 0;
+    read_switch_counts(&switch_start, &no_switches);
+    fork1("server", server, NULL, USLOSS_MIN_STACK, 3);
+    fork1("client", client, NULL, USLOSS_MIN_STACK, 3);
+    for (i = 0; i < WORKERS; i++)
+      fork1("worker", worker, NULL, USLOSS_MIN_STACK, 3);
+    for (i = 0; i < 2 + WORKERS; i++)
+      join(&status);
+    read_switch_counts(&switches, &no_switches);
+
+    qsort(round_ns, ROUNDS, sizeof(long), compare_longs);
+    printf("bench=handoff mode=%s rounds=%d workers=%d work_ns=%d p50_ns=%ld "
+           "p90_ns=%ld p99_ns=%ld switches_per_round=%.2f\n",
+           mode ? "handoff" : "plain", ROUNDS, WORKERS, WORK_NS,
+           round_ns[ROUNDS / 2],
+           round_ns[ROUNDS * 90 / 100], round_ns[ROUNDS * 99 / 100],
+           (double) (switches - switch_start) / ROUNDS);
+  }
+
+  quit(0);
+  return 0;
+}
+
+int client(char *arg)
+{
+  int i, request, reply;
+  long start;
+
+  for (i = 0; i <= ROUNDS; i++) {
+    request = i;
+    start = now_ns();
+    MboxSend(request_box, &request, sizeof(int));
+    if (i == ROUNDS)
+      break;
+    MboxReceive(reply_box, &reply, sizeof(int));
+    round_ns[i] = now_ns() - start;
+  }
+  done = 1;
+  quit(0);
+  return 0;
+}
+
+int server(char *arg)
+{
+  int request, reply;
+
+  for (;;) {
+    MboxReceive(request_box, &request, sizeof(int));
+    if (request == ROUNDS)
+      break;
+    reply = request + 1;
+    MboxSend(reply_box, &reply, sizeof(int));
+  }
+  quit(0);
+  return 0;
+}
+
+/* Works in WORK_NS pieces until the client is done */
+int worker(char *arg)
+{
+  long start;
+
+  while (!done) {
+    start = now_ns();
+    while (now_ns() - start < WORK_NS)
+      ;
+    dispatcher();
+  }
+  quit(0);
+  return 0;
+}
+
+long now_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+int compare_longs(const void *a, const void *b)
+{
+  long x = *(const long *) a, y = *(const long *) b;
+
+  return (x > y) - (x < y);
+}
@@ -0,0 +1,79 @@
+/* Compares passing a payload through a mailbox by copy and by reference.
+ *
+ * copy: the payload is split into MAX_MESSAGE byte messages, each one
+ *       MboxSend'd into a one slot mailbox and MboxReceive'd back out,
+ *       so every byte is copied in and out of a slot
+ * ref:  the payload is MboxSendRef'd into a MboxCreateRef mailbox and
+ *       MboxReceiveRef'd back out, one slot and no copy
+ *
+ * Both run in one process so no context switches are counted. Prints one
+ * "key=value" line per payload size and mode, times are wall clock
+ * nanoseconds.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <usloss.h>
+#include <phase1.h>
+#include <phase2.h>
+
+#define ITERATIONS 500
+
+long now_ns(void);
+
+int sizes[] = {16, MAX_MESSAGE, 1024, 8192, 65536};
+
+int start2(char *arg)
+{
+  int copy_box, ref_box, i, n, off, len, size;
+  char *payload, *out;
+  void *got;
+  long start, ns;
+
+  copy_box = MboxCreate(1, MAX_MESSAGE);
+  ref_box = MboxCreateRef(1);
+  payload = malloc(65536);
+  out = malloc(65536);
+  memset(payload, 'p', 65536);
+
+  for (n = 0; n < sizeof(sizes) / sizeof(sizes[0]); n++) {
+    size = sizes[n];
+
+    start = now_ns();
+    for (i = 0; i < ITERATIONS; i++) {
+      for (off = 0; off < size; off += len) {
+        len = size - off < MAX_MESSAGE ? size - off : MAX_MESSAGE;
+        MboxSend(copy_box, payload + off, len);
+        MboxReceive(copy_box, out + off, len);
+      }
+    }
+    ns = (now_ns() - start) / ITERATIONS;
+    printf("bench=ref mode=copy bytes=%d msgs=%d ns_per_payload=%ld "
+           "mb_per_sec=%.1f\n", size, (size + MAX_MESSAGE - 1) / MAX_MESSAGE,
+           ns, size * 1e3 / ns);
+
+    start = now_ns();
+    for (i = 0; i < ITERATIONS; i++) {
+      MboxSendRef(ref_box, payload, size);
+      MboxReceiveRef(ref_box, &got);
+    }
+    ns = (now_ns() - start) / ITERATIONS;
+    printf("bench=ref mode=ref bytes=%d msgs=1 ns_per_payload=%ld "
+           "mb_per_sec=%.1f\n", size, ns, size * 1e3 / ns);
+  }
+
+  free(payload);
+  free(out);
+  quit(0);
+  return 0;
+}
+
+long now_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
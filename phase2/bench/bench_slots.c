@@ -0,0 +1,84 @@
+/* Measures mailbox slot storage.
+ *
+ * Fills a mailbox with SLOTS_USED messages of one size and drains it again,
+ * for sizes from a status word up to MAX_MESSAGE. Messages of up to
+ * SLOT_INLINE bytes live in the slot, larger ones in pooled chunks, so the
+ * slot table stays small and only large messages touch the chunk pools.
+ * Every message is checked on the way out.
+ *
+ * Prints the size of the slot table, then one "key=value" line per message
+ * size with the wall clock nanoseconds per send and receive and the chunk
+ * bytes allocated so far.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <usloss.h>
+#include <phase1.h>
+#include <phase2.h>
+#include "message.h"
+
+#define SLOTS_USED 2000
+#define ROUNDS     20
+
+extern mail_slot slot_table[MAXSLOTS];
+extern long chunk_bytes;
+
+long now_ns(void);
+
+int sizes[] = {0, 4, 16, 17, 64, MAX_MESSAGE};
+
+int start2(char *arg)
+{
+  char in[MAX_MESSAGE], out[MAX_MESSAGE];
+  int box, i, n, r, size, errors = 0;
+  long start, ns;
+
+  printf("bench=slots slot_bytes=%d table_bytes=%d inline_bytes=%d\n",
+         (int) sizeof(mail_slot), (int) sizeof(slot_table), SLOT_INLINE);
+
+  box = MboxCreate(SLOTS_USED, MAX_MESSAGE);
+  for (n = 0; n < sizeof(sizes) / sizeof(sizes[0]); n++) {
+    size = sizes[n];
+
+    start = now_ns();
+    for (r = 0; r < ROUNDS; r++) {
+      for (i = 0; i < SLOTS_USED; i++) {
+        memset(in, i, size);
+        MboxSend(box, in, size);
+      }
+      for (i = 0; i < SLOTS_USED; i++) {
+        if (MboxReceive(box, out, sizeof(out)) != size ||
+            (size > 0 && (out[0] != (char) i || out[size - 1] != (char) i)))
+          errors++;
+      }
+    }
+    ns = (now_ns() - start) / (ROUNDS * SLOTS_USED);
+    printf("bench=slots bytes=%d ns_per_msg=%ld chunk_bytes=%ld\n",
+           size, ns, chunk_bytes);
+  }
+
+  /* Releasing a mailbox still holding large messages frees their chunks */
+  for (i = 0; i < SLOTS_USED; i++)
+    MboxSend(box, in, MAX_MESSAGE);
+  MboxRelease(box);
+  box = MboxCreate(SLOTS_USED, MAX_MESSAGE);
+  for (i = 0; i < SLOTS_USED; i++)
+    MboxSend(box, in, MAX_MESSAGE);
+  printf("bench=slots op=refill_after_release chunk_bytes=%ld\n", chunk_bytes);
+
+  if (errors != 0)
+    printf("bench=slots error=corrupt_messages count=%d\n", errors);
+
+  quit(0);
+  return 0;
+}
+
+long now_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
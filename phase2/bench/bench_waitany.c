@@ -0,0 +1,135 @@
+/* Measures a server taking requests from SOURCES mailboxes, each fed by
+ * its own client, with one helper process per mailbox and with
+ * MboxWaitAny.
+ *
+ * helpers: a helper per source mailbox MboxReceives from it and MboxSends
+ *          into one merged mailbox, which the server MboxReceives from
+ * waitany: the server MboxWaitAny's on the source mailboxes directly
+ *
+ * The clients run below the server, so every request wakes it. Prints one
+ * "key=value" line per mode: the processes taking part, wall clock
+ * nanoseconds and context switches per request.
+ */
+
+#include <stdio.h>
+#include <time.h>
+#include <usloss.h>
+#include <phase1.h>
+#include <phase2.h>
+
+#define SOURCES  4
+#define REQUESTS 5000   /* per source */
+
+int client(char *);
+int helper(char *);
+int server(char *);
+long now_ns(void);
+
+int boxes[SOURCES];
+int merged;
+int use_waitany;
+int errors;
+
+int start2(char *arg)
+{
+  char name[2][SOURCES][8];
+  int i, status, switches, no_switches, switch_start, procs;
+  long start;
+
+  for (use_waitany = 0; use_waitany <= 1; use_waitany++) {
+    for (i = 0; i < SOURCES; i++)
+      boxes[i] = MboxCreate(8, sizeof(int));
+    merged = MboxCreate(8, sizeof(int));
+    errors = 0;
+
+    read_switch_counts(&switch_start, &no_switches);
+    start = now_ns();
+    procs = 1 + SOURCES;
+    fork1("server", server, NULL, USLOSS_MIN_STACK, 2);
+    if (!use_waitany) {
+      for (i = 0; i < SOURCES; i++) {
+        sprintf(name[0][i], "%d", i);
+        fork1("helper", helper, name[0][i], USLOSS_MIN_STACK, 2);
+      }
+      procs += SOURCES;
+    }
+    for (i = 0; i < SOURCES; i++) {
+      sprintf(name[1][i], "%d", i);
+      fork1("client", client, name[1][i], USLOSS_MIN_STACK, 3);
+    }
+    for (i = 0; i < procs; i++)
+      join(&status);
+    read_switch_counts(&switches, &no_switches);
+
+    printf("bench=waitany mode=%s procs=%d requests=%d ns_per_request=%ld "
+           "switches_per_request=%.2f errors=%d\n",
+           use_waitany ? "waitany" : "helpers", procs, SOURCES * REQUESTS,
+           (now_ns() - start) / (SOURCES * REQUESTS),
+           (double) (switches - switch_start) / (SOURCES * REQUESTS), errors);
+
+    for (i = 0; i < SOURCES; i++)
+      MboxRelease(boxes[i]);
+    MboxRelease(merged);
+  }
+
+  quit(0);
+  return 0;
+}
+
+/* Sends REQUESTS numbered requests to its source mailbox */
+int client(char *arg)
+{
+  int source = arg[0] - '0';
+  int i, request;
+
+  for (i = 0; i < REQUESTS; i++) {
+    request = source * REQUESTS + i;
+    MboxSend(boxes[source], &request, sizeof(int));
+  }
+  quit(0);
+  return 0;
+}
+
+/* Forwards the requests of one source mailbox to the merged mailbox */
+int helper(char *arg)
+{
+  int source = arg[0] - '0';
+  int i, request;
+
+  for (i = 0; i < REQUESTS; i++) {
+    MboxReceive(boxes[source], &request, sizeof(int));
+    MboxSend(merged, &request, sizeof(int));
+  }
+  quit(0);
+  return 0;
+}
+
+/* Takes every request, checking each source's arrive in order */
+int server(char *arg)
+{
+  int next[SOURCES] = {0};
+  int i, request, source, mbox_id;
+
+  for (i = 0; i < SOURCES * REQUESTS; i++) {
+    if (use_waitany) {
+      MboxWaitAny(boxes, SOURCES, &request, sizeof(int), &mbox_id);
+      if (boxes[request / REQUESTS] != mbox_id)
+        errors++;
+    } else {
+      MboxReceive(merged, &request, sizeof(int));
+    }
+    source = request / REQUESTS;
+    if (request % REQUESTS != next[source]++)
+      errors++;
+  }
+  quit(0);
+  return 0;
+}
+
+long now_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
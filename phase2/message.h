@@ -5,6 +5,19 @@
 #define FAILED -1
 #define SEND_BLOCK 11
 #define RECV_BLOCK 12
+#define IO_MBOXES 7
+
+// Messages of up to SLOT_INLINE bytes are stored in the slot itself, larger
+// ones in a chunk from the pool of the smallest size class that holds them.
+// The last class holds MAX_MESSAGE, rounded up so every chunk is aligned.
+#define SLOT_INLINE 16
+#define CHUNK_CLASSES 3
+#define CHUNK_SIZES {32, 64, (MAX_MESSAGE + 7) & ~7}
+#define CHUNKS_PER_REFILL 64
+
+// Device statuses that arrive while no driver is waiting are kept, up to
+// STATUS_RING per unit, until a receive on the unit's mailbox takes them
+#define STATUS_RING 16
 
 typedef struct mailbox mailbox;
 typedef struct mbox_proc mbox_proc;
@@ -14,13 +27,18 @@ typedef struct mail_slot *slot_ptr;
 typedef struct mbox_proc *mbox_proc_ptr;
 
 struct mbox_proc {
-    short pid;
+    int pid;
     int status;
     void * message;
     int msg_size;
     int mbox_released;
     mbox_proc_ptr next_block_send;
     mbox_proc_ptr next_block_recv;
+    mbox_proc_ptr prev_block_recv;  // so a MboxWaitAny entry unlinks in O(1)
+    int wait_any;           // an entry of wait_any_table, not mbox_proc_table
+    int mbox_id;            // wait_any entry: the mailbox it waits on
+    int wait_count;         // MboxWaitAny caller: # of entries still waiting
+    int fired;              // MboxWaitAny caller: index of the entry woken
 };
 
 struct mailbox {
@@ -29,20 +47,57 @@ struct mailbox {
     int slots_used;
     int slot_size;
     mbox_proc_ptr block_send_list;
+    mbox_proc_ptr block_send_tail;
     mbox_proc_ptr block_recv_list;
+    mbox_proc_ptr block_recv_tail;
     slot_ptr slot_list;
+    slot_ptr slot_tail;
     int status;
+    int by_ref;             // made by MboxCreateRef, slots hold an mbox_ref
+    wait_queue waiters;     // every process blocked on this mailbox
+
+    // Activity counters, reported by MboxGetStats
+    int sends;
+    int receives;
+    int cond_failures;
+    int blocked_sends;
+    int blocked_receives;
+    int blocked_time;
+    int max_depth;
 };
 
 struct mail_slot {
     int slot_id;
     int mbox_id;
     int status;
-    char message[MAX_MESSAGE];
     int msg_size;
     slot_ptr next_slot;
+    union {
+        char inline_msg[SLOT_INLINE];   // msg_size <= SLOT_INLINE
+        char *chunk;                    // msg_size > SLOT_INLINE
+    } body;
 };
 
+// Free chunks of one size class, linked through their first bytes
+typedef struct chunk_pool {
+    int chunk_size;
+    char *free_list;
+} chunk_pool;
+
+// Pending statuses of one device unit, oldest at head
+typedef struct status_ring {
+    int status[STATUS_RING];
+    int head;
+    int count;
+    int overflows;          // statuses dropped because the ring was full
+} status_ring;
+
+// What a MboxCreateRef mailbox carries in place of the message itself
+typedef struct mbox_ref {
+    void *buffer;
+    int size;
+} mbox_ref;
+
 struct psr_bits {
     unsigned int cur_mode:1;
     unsigned int cur_int_enable:1;
@@ -4,8 +4,13 @@
 int start1(char *);
 void check_kernel_mode(char * processName);
 int check_io();
+void post_status(int mbox_id, int status);
+int send_message(int mbox_id, void *msg_ptr, int msg_size, int by_ref);
+int receive_message(int mbox_id, void *msg_ptr, int msg_size, int by_ref);
 void zero_mailbox(int mbox_id);
+void wait_on_mailbox(mailbox_ptr mbptr, int block_status);
 void zero_slot(int slot_id);
+void free_slot(int slot_id);
 void zero_mbox_proc(int pid);
 void nullsys(sysargs *args);
 void clock_handler2(int dev, long unit);
@@ -13,8 +18,22 @@ void disk_handler(int dev, long unit);
 void term_handler(int dev, long unit);
 void syscall_handler(int dev, void *unit);
 slot_ptr init_slot(int slot_index, int mbox_id, void *msg_ptr, int msg_size);
+char *slot_message(slot_ptr slot);
+int chunk_class(int size);
+char *alloc_chunk(int size);
+void free_chunk(char *chunk, int size);
 int get_slot_index();
+int put_message(mailbox_ptr mbptr, void *msg_ptr, int msg_size);
+int take_status(mailbox_ptr mbptr, void *msg_ptr, int msg_size);
+int take_message(mailbox_ptr mbptr, void *msg_ptr, int msg_size);
 int add_slot_to_list(slot_ptr slot_to_add, mailbox_ptr mbptr);
+slot_ptr pop_slot_list(mailbox_ptr mbptr);
+void add_to_send_list(mailbox_ptr mbptr, mbox_proc_ptr proc);
+mbox_proc_ptr pop_send_list(mailbox_ptr mbptr);
+void add_to_recv_list(mailbox_ptr mbptr, mbox_proc_ptr proc);
+mbox_proc_ptr pop_recv_list(mailbox_ptr mbptr);
+void remove_from_recv_list(mailbox_ptr mbptr, mbox_proc_ptr proc);
+void end_wait_any(mbox_proc_ptr entry);
 extern int start2(char *);
 void enableInterrupts();
 void disableInterrupts();
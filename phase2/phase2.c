@@ -22,8 +22,20 @@ int debugflag2 = 0;
 mailbox mailbox_table[MAXMBOX];
 mail_slot slot_table[MAXSLOTS];
 
-// Process table
-mbox_proc mbox_proc_table[MAXPROC];
+// Free slots of slot_table, linked through their next_slot
+slot_ptr free_slot_list = NULL;
+
+// Storage for messages too large to fit inline in a slot, one pool per
+// size class, and the bytes allocated to all of them so far
+chunk_pool chunk_pools[CHUNK_CLASSES];
+long chunk_bytes = 0;
+
+// Process table, num_proc_slots entries allocated by start1
+mbox_proc *mbox_proc_table;
+
+// MboxWaitAny entries, MAX_WAIT_ANY per process table slot, one on the
+// block receive list of each mailbox the process waits on
+mbox_proc *wait_any_table;
 
 // System call vector
 void (*sys_vec[MAXSYSCALLS])(sysargs *args);
@@ -31,6 +43,18 @@ void (*sys_vec[MAXSYSCALLS])(sysargs *args);
 // Counter used by clock
 int clock_counter = 0;
 
+// Statuses posted by the interrupt handlers, one ring per I/O mailbox
+status_ring status_rings[IO_MBOXES];
+
+// MboxSend to a zero-slot mailbox switches straight to a blocked receiver
+// through handoff_proc, cleared to use a plain unblock_proc instead
+int handoff_enabled = 1;
+
+// Number of processes blocked receiving on an interrupt mailbox, and
+// blocked sending or receiving on any other mailbox
+int num_io_blocked = 0;
+int num_ipc_blocked = 0;
+
 /* -------------------------- Functions ----------------------------------- */
 
 /* ------------------------------------------------------------------------
@@ -67,19 +91,33 @@ int start1(char *arg) {
     }
 
     // Create boxes for all the interrupt handlers
-    for (i = 0; i < 7; i++) {
+    for (i = 0; i < IO_MBOXES; i++) {
         MboxCreate(0,0);
     }
 
-    // Initialize all slots in the slot table
+    // Set up the chunk pools, they are filled on first use
+    int chunk_sizes[CHUNK_CLASSES] = CHUNK_SIZES;
+    for (i = 0; i < CHUNK_CLASSES; i++) {
+        chunk_pools[i].chunk_size = chunk_sizes[i];
+        chunk_pools[i].free_list = NULL;
+    }
+
+    // Initialize all slots in the slot table and put them on the free list,
+    // last slot first so they are handed out from slot 0 up
     // slot_table is an array of mail_slot's
-    for (i = 0; i < MAXSLOTS; i++) {
+    for (i = MAXSLOTS - 1; i >= 0; i--) {
         slot_table[i].slot_id = i;
-        zero_slot(i);
+        free_slot(i);
     }
 
-    // Initialize process table
-    for (i = 0; i < MAXPROC; i++) {
+    // Allocate and initialize process table
+    mbox_proc_table = malloc(num_proc_slots * sizeof(mbox_proc));
+    wait_any_table = calloc(num_proc_slots * MAX_WAIT_ANY, sizeof(mbox_proc));
+    if (mbox_proc_table == NULL || wait_any_table == NULL) {
+        console("start1(): cannot allocate process table. Halting...\n");
+        halt(1);
+    }
+    for (i = 0; i < num_proc_slots; i++) {
         zero_mbox_proc(i);
     }
 
@@ -148,6 +186,7 @@ int MboxCreate(int slots, int slot_size) {
             mailbox_table[i].slots_used = 0;
             mailbox_table[i].slot_size = slot_size;
             mailbox_table[i].status = USED;
+            mailbox_table[i].by_ref = 0;
 
             // Done creating box, enable interrupts
             enableInterrupts();
@@ -164,6 +203,26 @@ int MboxCreate(int slots, int slot_size) {
 } /* MboxCreate */
 
 
+/* ------------------------------------------------------------------------
+   Name - MboxCreateRef
+   Purpose - Creates a mailbox whose messages are passed by reference with
+             MboxSendRef and MboxReceiveRef. Each slot holds a buffer
+             pointer and size, so a message of any size costs one slot.
+   Parameters - maximum number of slots in the mailbox.
+   Returns - -1 to indicate that no mailbox was created, or a value >= 0 as the
+             mailbox id.
+   Side Effects - initializes one element of the mail box array.
+   ----------------------------------------------------------------------- */
+int MboxCreateRef(int slots) {
+    int mbox_id = MboxCreate(slots, sizeof(mbox_ref));
+
+    if (mbox_id >= 0) {
+        mailbox_table[mbox_id].by_ref = 1;
+    }
+    return mbox_id;
+} /* MboxCreateRef */
+
+
 /* ------------------------------------------------------------------------
    Name - MboxSend
    Purpose - Put a message into a slot for the indicated mailbox.
@@ -173,6 +232,46 @@ int MboxCreate(int slots, int slot_size) {
    Side Effects - none.
    ----------------------------------------------------------------------- */
 int MboxSend(int mbox_id, void *msg_ptr, int msg_size) {
+    return send_message(mbox_id, msg_ptr, msg_size, 0);
+} /* MboxSend */
+
+
+/* ------------------------------------------------------------------------
+   Name - MboxSendRef
+   Purpose - Hands a buffer to the receiver of a mailbox made by
+             MboxCreateRef, without copying it. The buffer belongs to the
+             receiver once this returns 0, the sender must not use it.
+             A buffer still queued when the mailbox is released is freed,
+             so it must come from malloc.
+   Parameters - mailbox id, the buffer, # of bytes in the buffer.
+   Returns - zero if successful, -1 if invalid args, -3 if zapped or the
+             mailbox was released.
+   Side Effects - none.
+   ----------------------------------------------------------------------- */
+int MboxSendRef(int mbox_id, void *buffer, int size) {
+    mbox_ref ref;
+
+    if (size < 0) {
+        return -1;
+    }
+    ref.buffer = buffer;
+    ref.size = size;
+    return send_message(mbox_id, &ref, sizeof(ref), 1);
+} /* MboxSendRef */
+
+
+/* ------------------------------------------------------------------------
+   Name - send_message
+   Purpose - MboxSend and MboxSendRef. Put a message into a slot for the
+             indicated mailbox. Block the sending process if no slot
+             available.
+   Parameters - mailbox id, pointer to data of msg, # of bytes in msg,
+                1 if the message is an mbox_ref for a MboxCreateRef
+                mailbox, 0 otherwise.
+   Returns - zero if successful, -1 if invalid args.
+   Side Effects - none.
+   ----------------------------------------------------------------------- */
+int send_message(int mbox_id, void *msg_ptr, int msg_size, int by_ref) {
     
     // Check kernel mode and disable interrupts
     check_kernel_mode("MboxSend");
@@ -198,18 +297,24 @@ int MboxSend(int mbox_id, void *msg_ptr, int msg_size) {
         return -1;
     }
 
+    // Messages by reference and by copy don't mix in one mailbox
+    if (mbptr->by_ref != by_ref) {
+        enableInterrupts();
+        return -1;
+    }
+
     // Add process to the process table
     // getpid() is a phase1.c function returning the current process ID
     int pid = getpid(); 
     
-    // MAXPROC - maximum number of processes defined in USLOSS/src/phase1.h (50)
-    // pid % MAXPROC = pid of the current process (who called this function)
+    // num_proc_slots - number of process table slots, set by phase1 at startup
+    // pid % num_proc_slots = slot of the current process (who called this function)
     // Set the mbox_proc up for this pid
     // Assign the pid, an ACTIVE status, set the '*message' = msg_ptr argument value, and the msg_size given by the argument value
-    mbox_proc_table[pid % MAXPROC].pid = pid;
-    mbox_proc_table[pid % MAXPROC].status = ACTIVE;
-    mbox_proc_table[pid % MAXPROC].message = msg_ptr;
-    mbox_proc_table[pid % MAXPROC].msg_size = msg_size;
+    mbox_proc_table[pid % num_proc_slots].pid = pid;
+    mbox_proc_table[pid % num_proc_slots].status = ACTIVE;
+    mbox_proc_table[pid % num_proc_slots].message = msg_ptr;
+    mbox_proc_table[pid % num_proc_slots].msg_size = msg_size;
 
     // Block if there no available slots and no process on receive list
     // Add to the next block send list
@@ -220,36 +325,17 @@ int MboxSend(int mbox_id, void *msg_ptr, int msg_size) {
     // We will block until a slot is available
     if (mbptr->num_slots <= mbptr->slots_used && mbptr->block_recv_list == NULL) {
         
-        // If the destination mailbox block send list is empty, 
-	// set the block send list mbox_proc_ptr as the mbox_proc of this pid
-	if (mbptr->block_send_list == NULL) {
-            
-            // Add this process as the first on the list
-            mbptr->block_send_list = &mbox_proc_table[pid % MAXPROC];
-
-        // The block send list is not empty
-        } else {
-
-            // Add this process to the end of the list
-            // by iterating through the list until we get to the end
-            mbox_proc_ptr temp = mbptr->block_send_list;
-            while (temp->next_block_send != NULL) {
-                temp = temp->next_block_send;
-            }
-
-            // Now that we're at the end of the list,
-            // we can add this process to the end of the list
-            temp->next_block_send = &mbox_proc_table[pid % MAXPROC];
-        }
+        // Add this process to the end of the block send list
+        add_to_send_list(mbptr, &mbox_proc_table[pid % num_proc_slots]);
 
         // Block this process now that we've added to the block send list
-        // block_me is a phase 1 function that blocks the current process, then calls the dispatcher afterwards
+        // wait_on_mailbox blocks the current process on the mailbox's wait queue, then calls the dispatcher afterwards
         // We are blocking because we are waiting for a slot to become available
-        block_me(SEND_BLOCK);
+        wait_on_mailbox(mbptr, SEND_BLOCK);
          
         // If the mailbox was released, enable interrupts
         // Return -3 
-        if(mbox_proc_table[pid % MAXPROC].mbox_released){
+        if(mbox_proc_table[pid % num_proc_slots].mbox_released){
           enableInterrupts();
           return -3;
         }
@@ -262,20 +348,26 @@ int MboxSend(int mbox_id, void *msg_ptr, int msg_size) {
 
         // Check if the message size is bigger than receive buffer size
         if (msg_size > mbptr->block_recv_list->msg_size) {
-            mbptr->block_recv_list->status = FAILED;
-            int pid = mbptr->block_recv_list->pid;
-            mbptr->block_recv_list = mbptr->block_recv_list->next_block_recv;
-            unblock_proc(pid);
+            mbox_proc_ptr receiver = pop_recv_list(mbptr);
+            receiver->status = FAILED;
+            unblock_proc(receiver->pid);
             enableInterrupts();
             return -1;
         }
 
         // Copy the message to the receive process buffer
-        memcpy(mbptr->block_recv_list->message, msg_ptr, msg_size);
-        mbptr->block_recv_list->msg_size = msg_size;
-        int recvPid = mbptr->block_recv_list->pid;
-        mbptr->block_recv_list = mbptr->block_recv_list->next_block_recv;
-        unblock_proc(recvPid);
+        mbox_proc_ptr receiver = pop_recv_list(mbptr);
+        memcpy(receiver->message, msg_ptr, msg_size);
+        receiver->msg_size = msg_size;
+        mbptr->sends++;
+        mbptr->receives++;
+
+        // A rendezvous, run the receiver now if its priority allows
+        if (mbptr->num_slots == 0 && handoff_enabled) {
+            handoff_proc(receiver->pid);
+        } else {
+            unblock_proc(receiver->pid);
+        }
         enableInterrupts();
         return is_zapped() ? -3 : 0;
     }
@@ -308,6 +400,44 @@ int MboxSend(int mbox_id, void *msg_ptr, int msg_size) {
    Side Effects - none.
    ----------------------------------------------------------------------- */
 int MboxReceive(int mbox_id, void *msg_ptr, int msg_size) {
+    return receive_message(mbox_id, msg_ptr, msg_size, 0);
+} /* MboxReceive */
+
+
+/* ------------------------------------------------------------------------
+   Name - MboxReceiveRef
+   Purpose - Takes the next buffer sent with MboxSendRef to a mailbox made
+             by MboxCreateRef. The receiver owns the buffer from then on.
+             Block the receiving process if no msg available.
+   Parameters - mailbox id, where to store the buffer.
+   Returns - # of bytes in the buffer if successful, -1 if invalid args,
+             -3 if zapped or the mailbox was released.
+   Side Effects - none.
+   ----------------------------------------------------------------------- */
+int MboxReceiveRef(int mbox_id, void **buffer) {
+    mbox_ref ref;
+    int result = receive_message(mbox_id, &ref, sizeof(ref), 1);
+
+    if (result < 0) {
+        return result;
+    }
+    *buffer = ref.buffer;
+    return ref.size;
+} /* MboxReceiveRef */
+
+
+/* ------------------------------------------------------------------------
+   Name - receive_message
+   Purpose - MboxReceive and MboxReceiveRef. Get a msg from a slot of the
+             indicated mailbox. Block the receiving process if no msg
+             available.
+   Parameters - mailbox id, pointer to put data of msg, max # of bytes that
+                can be received, 1 to receive an mbox_ref from a
+                MboxCreateRef mailbox, 0 otherwise.
+   Returns - actual size of msg if successful, -1 if invalid args.
+   Side Effects - none.
+   ----------------------------------------------------------------------- */
+int receive_message(int mbox_id, void *msg_ptr, int msg_size, int by_ref) {
     check_kernel_mode("MboxReceive");
 
     disableInterrupts();
@@ -328,20 +458,38 @@ int MboxReceive(int mbox_id, void *msg_ptr, int msg_size) {
     // Retrieve the pointer to the specified mailbox
     mailbox_ptr mbptr = &mailbox_table[mbox_id];
 
+    // Messages by reference and by copy don't mix in one mailbox
+    if (mbptr->by_ref != by_ref) {
+        enableInterrupts();
+        return -1;
+    }
+
+    // A device status that arrived while no one was waiting comes first
+    int status_size = take_status(mbptr, msg_ptr, msg_size);
+    if (status_size != -2) {
+        enableInterrupts();
+        return status_size;
+    }
+
     // Add process to process Table
     int pid = getpid();
-    mbox_proc_table[pid % MAXPROC].pid = pid;
-    mbox_proc_table[pid % MAXPROC].status = ACTIVE;
-    mbox_proc_table[pid % MAXPROC].message = msg_ptr;
-    mbox_proc_table[pid % MAXPROC].msg_size = msg_size;
+    mbox_proc_table[pid % num_proc_slots].pid = pid;
+    mbox_proc_table[pid % num_proc_slots].status = ACTIVE;
+    mbox_proc_table[pid % num_proc_slots].message = msg_ptr;
+    mbox_proc_table[pid % num_proc_slots].msg_size = msg_size;
 
     // The mailbox is has zero slots and there is a process on send list
     if (mbptr->num_slots == 0 && mbptr->block_send_list != NULL) {
-        mbox_proc_ptr sender = mbptr->block_send_list;
-        memcpy(msg_ptr, sender->message, sender->msg_size);
-        mbptr->block_send_list = mbptr->block_send_list->next_block_send;
+        mbox_proc_ptr sender = pop_send_list(mbptr);
+        int sent_size = sender->msg_size;
+        memcpy(msg_ptr, sender->message, sent_size);
+        mbptr->sends++;
+        mbptr->receives++;
+
+        // The sender may run, and reuse its entry, once interrupts are on
         unblock_proc(sender->pid);
-        return sender->msg_size;
+        enableInterrupts();
+        return sent_size;
     }
 
     // Retrieve the pointer to the first slot in the list
@@ -351,15 +499,7 @@ int MboxReceive(int mbox_id, void *msg_ptr, int msg_size) {
     if (first_slot == NULL) {
 
         // Receive process adds itself to receive list
-        if (mbptr->block_recv_list == NULL) {
-            mbptr->block_recv_list = &mbox_proc_table[pid % MAXPROC];
-        } else {
-            mbox_proc_ptr temp = mbptr->block_recv_list;
-            while (temp->next_block_recv != NULL) {
-                temp = temp->next_block_recv;
-            }
-            temp->next_block_recv = &mbox_proc_table[pid % MAXPROC];
-        }
+        add_to_recv_list(mbptr, &mbox_proc_table[pid % num_proc_slots]);
         
         // Debug info for test 13
         if (DEBUG2 && debugflag2) {
@@ -367,22 +507,22 @@ int MboxReceive(int mbox_id, void *msg_ptr, int msg_size) {
         }
 
         // Block until sender arrives at mailbox
-        block_me(RECV_BLOCK);
+        wait_on_mailbox(mbptr, RECV_BLOCK);
 
         // The process was zapped or the mailbox was released
-        if(mbox_proc_table[pid % MAXPROC].mbox_released || is_zapped()){
+        if(mbox_proc_table[pid % num_proc_slots].mbox_released || is_zapped()){
            enableInterrupts();
            return -3;
         }
 
         // Check if we failed to receive the message, if so, return failed
-        if(mbox_proc_table[pid % MAXPROC].status == FAILED) {
+        if(mbox_proc_table[pid % num_proc_slots].status == FAILED) {
             enableInterrupts();
             return -1;
         }
 
         enableInterrupts();
-        return mbox_proc_table[pid % MAXPROC].msg_size;
+        return mbox_proc_table[pid % num_proc_slots].msg_size;
 
     } else {
         // There's a message available on the slot list
@@ -394,10 +534,10 @@ int MboxReceive(int mbox_id, void *msg_ptr, int msg_size) {
         }
 
         // Copy message into receive messsage buffer
-        memcpy(msg_ptr, first_slot->message, first_slot->msg_size);
-        mbptr->slot_list = first_slot->next_slot;
+        memcpy(msg_ptr, slot_message(first_slot), first_slot->msg_size);
+        pop_slot_list(mbptr);
         int msg_size = first_slot->msg_size;
-        zero_slot(first_slot->slot_id);
+        free_slot(first_slot->slot_id);
         mbptr->slots_used--;
 
         // there is a message on the send list waiting for a slot
@@ -405,17 +545,16 @@ int MboxReceive(int mbox_id, void *msg_ptr, int msg_size) {
 
             // Determine the index from the list
             int slot_index = get_slot_index();
+            mbox_proc_ptr sender = pop_send_list(mbptr);
 
             // Initialize the slot with the message and message size
-            slot_ptr slot_to_add = init_slot(slot_index, mbptr->mbox_id, mbptr->block_send_list->message, mbptr->block_send_list->msg_size);
+            slot_ptr slot_to_add = init_slot(slot_index, mbptr->mbox_id, sender->message, sender->msg_size);
 
             // Add the slot to the slot list
             add_slot_to_list(slot_to_add, mbptr);
 
             // Wake up the process blocked on the send list
-            int pid = mbptr->block_send_list->pid;
-            mbptr->block_send_list = mbptr->block_send_list->next_block_send;
-            unblock_proc(pid);
+            unblock_proc(sender->pid);
         }
 
         enableInterrupts();
@@ -461,20 +600,21 @@ int MboxRelease(int mbox_id) {
         // Set all processes on the block send and receive list as released
         // Send list
         while (mbptr->block_send_list != NULL) {
-            mbptr->block_send_list->mbox_released = 1;
-            int pid = mbptr->block_send_list->pid;
-            mbptr->block_send_list = mbptr->block_send_list->next_block_send;
-            unblock_proc(pid);
-            disableInterrupts();
+            pop_send_list(mbptr)->mbox_released = 1;
         }
-        // Receive list
+        // Receive list, a MboxWaitAny waiter isn't on the mailbox's wait
+        // queue and is woken by pid
         while (mbptr->block_recv_list != NULL) {
-            mbptr->block_recv_list->mbox_released = 1;
-            int pid = mbptr->block_recv_list->pid;
-            mbptr->block_recv_list = mbptr->block_recv_list->next_block_recv;
-            unblock_proc(pid);
-            disableInterrupts();
+            mbox_proc_ptr receiver = pop_recv_list(mbptr);
+            receiver->mbox_released = 1;
+            if (receiver->wait_any) {
+                unblock_proc(receiver->pid);
+            }
         }
+
+        // Wake them all with a single dispatch
+        wait_queue_wake_all(&mbptr->waiters);
+        disableInterrupts();
     }
 
     // Zero all the variables of the mailbox
@@ -508,21 +648,29 @@ int MboxCondSend(int mbox_id, void *msg_ptr, int msg_size){
         enableInterrupts();
         return -1;
     }
+    if (mbptr->by_ref) {
+        enableInterrupts();
+        return -1;
+    }
 
     // Add process to the process Table
     int pid = getpid();
-    mbox_proc_table[pid % MAXPROC].pid = pid;
-    mbox_proc_table[pid % MAXPROC].status = ACTIVE;
-    mbox_proc_table[pid % MAXPROC].message = msg_ptr;
-    mbox_proc_table[pid % MAXPROC].msg_size = msg_size;
+    mbox_proc_table[pid % num_proc_slots].pid = pid;
+    mbox_proc_table[pid % num_proc_slots].status = ACTIVE;
+    mbox_proc_table[pid % num_proc_slots].message = msg_ptr;
+    mbox_proc_table[pid % num_proc_slots].msg_size = msg_size;
 
     // No empty slots in mailbox or no slots in system
     if (mbptr->num_slots != 0 && mbptr->num_slots == mbptr->slots_used) {
+        mbptr->cond_failures++;
+        enableInterrupts();
         return -2;
     }
 
     // Zero slot mailbox and no process blocked on recveive list
     if (mbptr->block_recv_list == NULL && mbptr->num_slots == 0) {
+        mbptr->cond_failures++;
+        enableInterrupts();
         return -1;
     }
 
@@ -534,11 +682,12 @@ int MboxCondSend(int mbox_id, void *msg_ptr, int msg_size){
         }
 
         // Copy message into the blocked receive process message buffer
-        memcpy(mbptr->block_recv_list->message, msg_ptr, msg_size);
-        mbptr->block_recv_list->msg_size = msg_size;
-        int recvPid = mbptr->block_recv_list->pid;
-        mbptr->block_recv_list = mbptr->block_recv_list->next_block_recv;
-        unblock_proc(recvPid);
+        mbox_proc_ptr receiver = pop_recv_list(mbptr);
+        memcpy(receiver->message, msg_ptr, msg_size);
+        receiver->msg_size = msg_size;
+        mbptr->sends++;
+        mbptr->receives++;
+        unblock_proc(receiver->pid);
         enableInterrupts();
         return is_zapped() ? -3 : 0;
     }
@@ -546,6 +695,8 @@ int MboxCondSend(int mbox_id, void *msg_ptr, int msg_size){
     // Search for an empty slot in slot_table, if it returns -2, no slot is available
     int slot = get_slot_index();
     if (slot == -2) {
+        mbptr->cond_failures++;
+        enableInterrupts();
         return -2;
     }
 
@@ -584,21 +735,37 @@ int MboxCondReceive(int mbox_id, void *msg_ptr,int msg_size){
 
     // Retrieve the pointer to the given mailbox
     mailbox_ptr mbptr = &mailbox_table[mbox_id];
+    if (mbptr->by_ref) {
+        enableInterrupts();
+        return -1;
+    }
+
+    // A device status that arrived while no one was waiting comes first
+    int status_size = take_status(mbptr, msg_ptr, msg_size);
+    if (status_size != -2) {
+        enableInterrupts();
+        return status_size;
+    }
 
     // Add process to the process table
     int pid = getpid();
-    mbox_proc_table[pid % MAXPROC].pid = pid;
-    mbox_proc_table[pid % MAXPROC].status = ACTIVE;
-    mbox_proc_table[pid % MAXPROC].message = msg_ptr;
-    mbox_proc_table[pid % MAXPROC].msg_size = msg_size;
+    mbox_proc_table[pid % num_proc_slots].pid = pid;
+    mbox_proc_table[pid % num_proc_slots].status = ACTIVE;
+    mbox_proc_table[pid % num_proc_slots].message = msg_ptr;
+    mbox_proc_table[pid % num_proc_slots].msg_size = msg_size;
 
     // The mailbox has zero slots and there is a process on the send list
     if (mbptr->num_slots == 0 && mbptr->block_send_list != NULL) {
-        mbox_proc_ptr sender = mbptr->block_send_list;
-        memcpy(msg_ptr, sender->message, sender->msg_size);
-        mbptr->block_send_list = mbptr->block_send_list->next_block_send;
+        mbox_proc_ptr sender = pop_send_list(mbptr);
+        int sent_size = sender->msg_size;
+        memcpy(msg_ptr, sender->message, sent_size);
+        mbptr->sends++;
+        mbptr->receives++;
+
+        // The sender may run, and reuse its entry, once interrupts are on
         unblock_proc(sender->pid);
-        return sender->msg_size;
+        enableInterrupts();
+        return sent_size;
     }
 
     // Retrieve the pointer to the first slot on the list
@@ -606,6 +773,7 @@ int MboxCondReceive(int mbox_id, void *msg_ptr,int msg_size){
 
     // Check if there is no message available
     if (first_slot == NULL) {
+        mbptr->cond_failures++;
         enableInterrupts();
         return -2;
 
@@ -619,10 +787,10 @@ int MboxCondReceive(int mbox_id, void *msg_ptr,int msg_size){
         }
 
         // Copy the message into the receive messsage buffer
-        memcpy(msg_ptr, first_slot->message, first_slot->msg_size);
-        mbptr->slot_list = first_slot->next_slot;
+        memcpy(msg_ptr, slot_message(first_slot), first_slot->msg_size);
+        pop_slot_list(mbptr);
         int msg_size = first_slot->msg_size;
-        zero_slot(first_slot->slot_id);
+        free_slot(first_slot->slot_id);
         mbptr->slots_used--;
 
         // Check if there is a message on the send list waiting for a slot
@@ -630,19 +798,17 @@ int MboxCondReceive(int mbox_id, void *msg_ptr,int msg_size){
 
             // Determine the next slot
             int slot_index = get_slot_index();
+            mbox_proc_ptr sender = pop_send_list(mbptr);
 
             // Now initialize the slot with the message and message size
             slot_ptr slot_to_add = init_slot(slot_index, mbptr->mbox_id,
-                    mbptr->block_send_list->message,
-                    mbptr->block_send_list->msg_size);
+                    sender->message, sender->msg_size);
 
             // Add the slot to the slot list
             add_slot_to_list(slot_to_add, mbptr);
 
             // Wake up a process blocked on the send list
-            int pid = mbptr->block_send_list->pid;
-            mbptr->block_send_list = mbptr->block_send_list->next_block_send;
-            unblock_proc(pid);
+            unblock_proc(sender->pid);
         }
 
         enableInterrupts();
@@ -650,9 +816,313 @@ int MboxCondReceive(int mbox_id, void *msg_ptr,int msg_size){
     }
 }
 
+/* ------------------------------------------------------------------------
+   Name - MboxSendMany
+   Purpose - Puts count messages into the indicated mailbox under one
+             critical section. Receivers woken along the way are
+             dispatched once, when it ends. Blocks, as MboxSend does,
+             whenever the mailbox is full.
+   Parameters - mailbox id, pointer to the messages, stored back to back,
+                # of bytes in each msg, # of msgs.
+   Returns - zero if successful, -1 if invalid args or a blocked
+             receiver's buffer is too small (the msgs before it were
+             sent), -3 if zapped or the mailbox was released.
+   Side Effects - none.
+   ----------------------------------------------------------------------- */
+int MboxSendMany(int mbox_id, void *msg_ptr, int msg_size, int count) {
+    check_kernel_mode("MboxSendMany");
+    disableInterrupts();
+
+    // Check for invalid parameters
+    if (mbox_id < 0 || mbox_id >= MAXMBOX) {
+        enableInterrupts();
+        return -1;
+    }
+    mailbox_ptr mbptr = &mailbox_table[mbox_id];
+    if (mbptr->status == EMPTY || mbptr->by_ref || count < 0 || msg_size < 0) {
+        enableInterrupts();
+        return -1;
+    }
+    if (mbptr->num_slots != 0 && msg_size > mbptr->slot_size) {
+        enableInterrupts();
+        return -1;
+    }
+
+    int pid = getpid();
+    mbox_proc_ptr proc = &mbox_proc_table[pid % num_proc_slots];
+    int sent;
+
+    for (sent = 0; sent < count; sent++) {
+        char *msg = (char *) msg_ptr + sent * msg_size;
+        int result = put_message(mbptr, msg, msg_size);
+
+        if (result == -1) {
+            enableInterrupts();
+            return -1;
+        }
+        if (result == -2 && mbptr->slots_used < mbptr->num_slots) {
+            console("MboxSendMany(): No slots in system. Halting...\n");
+            halt(1);
+        }
+
+        // The mailbox is full, block until a receiver takes this message
+        if (result == -2) {
+            proc->pid = pid;
+            proc->status = ACTIVE;
+            proc->message = msg;
+            proc->msg_size = msg_size;
+            proc->mbox_released = 0;
+            add_to_send_list(mbptr, proc);
+
+            wait_on_mailbox(mbptr, SEND_BLOCK);
+
+            if (proc->mbox_released || is_zapped()) {
+                enableInterrupts();
+                return -3;
+            }
+            disableInterrupts();
+        }
+    }
+
+    enableInterrupts();
+    return is_zapped() ? -3 : 0;
+} /* MboxSendMany */
+
+/* ------------------------------------------------------------------------
+   Name - MboxReceiveMany
+   Purpose - Gets up to count msgs from the indicated mailbox under one
+             critical section. Blocks, as MboxReceive does, until there
+             is at least one, then takes the rest of those waiting.
+             Senders woken along the way are dispatched once, when it
+             ends.
+   Parameters - mailbox id, where to put the msgs, every msg_max_size
+                bytes, max # of bytes in each msg, max # of msgs, where to
+                put the size of each msg received (may be NULL).
+   Returns - # of msgs received if successful, -1 if invalid args or the
+             first msg is too big, -3 if zapped or the mailbox was
+             released.
+   Side Effects - none.
+   ----------------------------------------------------------------------- */
+int MboxReceiveMany(int mbox_id, void *msg_ptr, int msg_max_size, int count,
+                    int *sizes) {
+    check_kernel_mode("MboxReceiveMany");
+    disableInterrupts();
+
+    // Check for invalid parameters
+    if (mbox_id < 0 || mbox_id >= MAXMBOX) {
+        enableInterrupts();
+        return -1;
+    }
+    mailbox_ptr mbptr = &mailbox_table[mbox_id];
+    if (mbptr->status == EMPTY || mbptr->by_ref || count < 1 || msg_max_size < 0) {
+        enableInterrupts();
+        return -1;
+    }
+
+    int pid = getpid();
+    mbox_proc_ptr proc = &mbox_proc_table[pid % num_proc_slots];
+    int received = 0;
+    int size = take_message(mbptr, msg_ptr, msg_max_size);
+
+    if (size == -1) {
+        enableInterrupts();
+        return -1;
+    }
+
+    // No message yet, block until a sender delivers the first one
+    if (size == -2) {
+        proc->pid = pid;
+        proc->status = ACTIVE;
+        proc->message = msg_ptr;
+        proc->msg_size = msg_max_size;
+        proc->mbox_released = 0;
+        add_to_recv_list(mbptr, proc);
+
+        wait_on_mailbox(mbptr, RECV_BLOCK);
+
+        if (proc->mbox_released || is_zapped()) {
+            enableInterrupts();
+            return -3;
+        }
+        if (proc->status == FAILED) {
+            enableInterrupts();
+            return -1;
+        }
+        size = proc->msg_size;
+        disableInterrupts();
+    }
+
+    // Take the messages already waiting, until one doesn't fit
+    while (size >= 0) {
+        if (sizes != NULL) {
+            sizes[received] = size;
+        }
+        received++;
+        if (received == count) {
+            break;
+        }
+        size = take_message(mbptr, (char *) msg_ptr + received * msg_max_size,
+                            msg_max_size);
+    }
+
+    enableInterrupts();
+    return is_zapped() ? -3 : received;
+} /* MboxReceiveMany */
+
+/* ------------------------------------------------------------------------
+   Name - MboxWaitAny
+   Purpose - Receives the first msg to arrive at any of a set of mailboxes.
+             A msg already waiting is taken at once, from the first
+             mailbox in mbox_ids that has one. Otherwise the process is
+             put on the block receive list of every mailbox and blocks;
+             the first sender to any of them delivers to it and takes it
+             off the others.
+   Parameters - the mailbox ids, # of ids, pointer to put data of msg, max
+                # of bytes that can be received, where to put the id of
+                the mailbox received from.
+   Returns - actual size of msg if successful, -1 if invalid args or the
+             msg is too big, -3 if zapped or the mailbox was released.
+   Side Effects - none.
+   ----------------------------------------------------------------------- */
+int MboxWaitAny(int *mbox_ids, int count, void *msg_ptr, int msg_max_size,
+                int *mbox_id) {
+    check_kernel_mode("MboxWaitAny");
+    disableInterrupts();
+
+    int i;
+
+    // Check for invalid parameters
+    if (count < 1 || count > MAX_WAIT_ANY || msg_max_size < 0) {
+        enableInterrupts();
+        return -1;
+    }
+    for (i = 0; i < count; i++) {
+        if (mbox_ids[i] < 0 || mbox_ids[i] >= MAXMBOX ||
+                mailbox_table[mbox_ids[i]].status == EMPTY ||
+                mailbox_table[mbox_ids[i]].by_ref) {
+            enableInterrupts();
+            return -1;
+        }
+    }
+
+    // Take a message that is already waiting
+    for (i = 0; i < count; i++) {
+        int size = take_message(&mailbox_table[mbox_ids[i]], msg_ptr, msg_max_size);
+        if (size != -2) {
+            *mbox_id = mbox_ids[i];
+            enableInterrupts();
+            return size;
+        }
+    }
+
+    // Wait on every mailbox, with one entry on each block receive list
+    int pid = getpid();
+    mbox_proc_ptr proc = &mbox_proc_table[pid % num_proc_slots];
+    mbox_proc_ptr entries = &wait_any_table[(pid % num_proc_slots) * MAX_WAIT_ANY];
+    int io = 0;
+
+    for (i = 0; i < count; i++) {
+        entries[i].pid = pid;
+        entries[i].status = ACTIVE;
+        entries[i].message = msg_ptr;
+        entries[i].msg_size = msg_max_size;
+        entries[i].mbox_released = 0;
+        entries[i].wait_any = 1;
+        entries[i].mbox_id = mbox_ids[i];
+        add_to_recv_list(&mailbox_table[mbox_ids[i]], &entries[i]);
+        mailbox_table[mbox_ids[i]].blocked_receives++;
+        if (mbox_ids[i] < IO_MBOXES) {
+            io = 1;
+        }
+    }
+    proc->wait_count = count;
+    proc->fired = -1;
+
+    int start = sys_clock();
+    if (io) {
+        num_io_blocked++;
+        block_me(RECV_BLOCK);
+        num_io_blocked--;
+    } else {
+        num_ipc_blocked++;
+        block_me(RECV_BLOCK);
+        num_ipc_blocked--;
+    }
+    disableInterrupts();
+
+    // Woken without a message, e.g. by unblock_proc, leave every list
+    if (proc->fired < 0) {
+        for (i = 0; i < proc->wait_count; i++) {
+            remove_from_recv_list(&mailbox_table[entries[i].mbox_id], &entries[i]);
+        }
+        proc->wait_count = 0;
+        enableInterrupts();
+        return -3;
+    }
+
+    mbox_proc_ptr entry = &entries[proc->fired];
+    *mbox_id = entry->mbox_id;
+
+    if (entry->mbox_released || is_zapped()) {
+        enableInterrupts();
+        return -3;
+    }
+    mailbox_table[entry->mbox_id].blocked_time += sys_clock() - start;
+    if (entry->status == FAILED) {
+        enableInterrupts();
+        return -1;
+    }
+    enableInterrupts();
+    return entry->msg_size;
+} /* MboxWaitAny */
+
+/* ------------------------------------------------------------------------
+   Name - MboxGetStats
+   Purpose - Takes a snapshot of the activity counters of the mailboxes in
+             use, in mailbox id order.
+   Parameters - where to put the counters, max # of mailboxes to report.
+   Returns - # of mailboxes reported, -1 if invalid args.
+   Side Effects - none.
+   ----------------------------------------------------------------------- */
+int MboxGetStats(mbox_stats *stats, int max) {
+    check_kernel_mode("MboxGetStats");
+    disableInterrupts();
+
+    if (stats == NULL || max < 0) {
+        enableInterrupts();
+        return -1;
+    }
+
+    int i;
+    int count = 0;
+    for (i = 0; i < MAXMBOX && count < max; i++) {
+        mailbox_ptr mbptr = &mailbox_table[i];
+
+        if (mbptr->status == EMPTY) {
+            continue;
+        }
+        stats[count].mbox_id = i;
+        stats[count].num_slots = mbptr->num_slots;
+        stats[count].slots_used = mbptr->slots_used;
+        stats[count].sends = mbptr->sends;
+        stats[count].receives = mbptr->receives;
+        stats[count].cond_failures = mbptr->cond_failures;
+        stats[count].blocked_sends = mbptr->blocked_sends;
+        stats[count].blocked_receives = mbptr->blocked_receives;
+        stats[count].blocked_time = mbptr->blocked_time;
+        stats[count].max_depth = mbptr->max_depth;
+        stats[count].overflows = i < IO_MBOXES ? status_rings[i].overflows : 0;
+        count++;
+    }
+
+    enableInterrupts();
+    return count;
+} /* MboxGetStats */
+
 /* ------------------------------------------------------------------------
    Name - waitdevice
-   Purpose - Block the process on the device until the device sends msg.
+   Purpose - Take the oldest status the device posted, blocking the
+             process on the device until it sends one if none is pending.
    Parameters - type, unit, status
    Returns - -1 if zapped, 0 otherwise
    Side Effects - none.
@@ -693,11 +1163,42 @@ int waitdevice(int type, int unit, int *status){
 	    halt(1);
     }
 
-    // Now we wait for the return code of the device
+    // Now we wait for the return code of the device, MboxReceive takes
+    // one that arrived while no one was waiting without blocking
     return_code = MboxReceive(deviceID, status, sizeof(int));
     return return_code == -3 ? -1 : 0;
 }
 
+/*
+ * Hands a device status to the process waiting on its I/O mailbox, or
+ * keeps it in the unit's ring for the next receive. A status that finds
+ * the ring full is dropped and counted.
+ */
+void post_status(int mbox_id, int status) {
+    status_ring *ring = &status_rings[mbox_id];
+    int oldest;
+
+    if (mailbox_table[mbox_id].block_recv_list != NULL) {
+        // Statuses are delivered in order, the new one goes behind any
+        // still in the ring
+        if (ring->count > 0) {
+            oldest = ring->status[ring->head];
+            ring->head = (ring->head + 1) % STATUS_RING;
+            ring->status[(ring->head + ring->count - 1) % STATUS_RING] = status;
+            status = oldest;
+        }
+        MboxCondSend(mbox_id, &status, sizeof(int));
+        return;
+    }
+    if (ring->count == STATUS_RING) {
+        ring->overflows++;
+        return;
+    }
+    ring->status[(ring->head + ring->count) % STATUS_RING] = status;
+    ring->count++;
+    mailbox_table[mbox_id].sends++;
+}
+
 /*
  *check_kernel_mode
  */
@@ -713,48 +1214,121 @@ void check_kernel_mode(char * processName) {
  * Determines if any procs are blocked on an IO mailbox
  */
 int check_io() {
-    int i;
-    for (i = 0; i < 7; i++) {
-        if (mailbox_table[i].block_recv_list != NULL) {
-            return 1;
-        }
-    }
-    return 0;
+    return num_io_blocked > 0;
 }
 
 /*
- * Zeros all variables of the mailbox for the given mailbox ID parameter
+ * Zeros all variables of the mailbox for the given mailbox ID parameter,
+ * returning any slots still holding its messages to the free list. The
+ * buffer of a by-reference message no one received belongs to the
+ * mailbox, and is freed with it.
  */
 void zero_mailbox(int mbox_id) {
+    slot_ptr slot = mailbox_table[mbox_id].slot_list;
+    while (slot != NULL) {
+        slot_ptr next = slot->next_slot;
+        if (mailbox_table[mbox_id].by_ref) {
+            mbox_ref ref;
+            memcpy(&ref, slot_message(slot), sizeof(ref));
+            free(ref.buffer);
+        }
+        free_slot(slot->slot_id);
+        slot = next;
+    }
+
     mailbox_table[mbox_id].num_slots = -1;
     mailbox_table[mbox_id].slots_used = -1;
     mailbox_table[mbox_id].slot_size = -1;
     mailbox_table[mbox_id].block_send_list = NULL;
+    mailbox_table[mbox_id].block_send_tail = NULL;
     mailbox_table[mbox_id].block_recv_list = NULL;
+    mailbox_table[mbox_id].block_recv_tail = NULL;
     mailbox_table[mbox_id].slot_list = NULL;
+    mailbox_table[mbox_id].slot_tail = NULL;
     mailbox_table[mbox_id].status = EMPTY;
+    mailbox_table[mbox_id].by_ref = 0;
+    wait_queue_init(&mailbox_table[mbox_id].waiters);
+    mailbox_table[mbox_id].sends = 0;
+    mailbox_table[mbox_id].receives = 0;
+    mailbox_table[mbox_id].cond_failures = 0;
+    mailbox_table[mbox_id].blocked_sends = 0;
+    mailbox_table[mbox_id].blocked_receives = 0;
+    mailbox_table[mbox_id].blocked_time = 0;
+    mailbox_table[mbox_id].max_depth = 0;
+}
+
+/*
+ * Blocks the current process on the wait queue of a mailbox, counting the
+ * block and the time spent blocked against the mailbox
+ */
+void wait_on_mailbox(mailbox_ptr mbptr, int block_status) {
+    int io = block_status == RECV_BLOCK && mbptr->mbox_id < IO_MBOXES;
+    int start = sys_clock();
+
+    if (block_status == SEND_BLOCK) {
+        mbptr->blocked_sends++;
+    } else {
+        mbptr->blocked_receives++;
+    }
+
+    if (io) {
+        num_io_blocked++;
+    } else {
+        num_ipc_blocked++;
+    }
+    wait_queue_wait(&mbptr->waiters, block_status);
+    if (io) {
+        num_io_blocked--;
+    } else {
+        num_ipc_blocked--;
+    }
+
+    // A released mailbox has been zeroed, and may be in use again
+    if (!mbox_proc_table[getpid() % num_proc_slots].mbox_released) {
+        mbptr->blocked_time += sys_clock() - start;
+    }
 }
 
 /*
- * Zeros all variables of the slot for the given slot ID parameter
+ * Zeros all variables of the slot for the given slot ID parameter,
+ * returning the chunk of a large message to its pool
  */
 void zero_slot(int slot_id) {
+    if (slot_table[slot_id].status == USED &&
+            slot_table[slot_id].msg_size > SLOT_INLINE) {
+        free_chunk(slot_table[slot_id].body.chunk, slot_table[slot_id].msg_size);
+    }
+    slot_table[slot_id].msg_size = 0;
     slot_table[slot_id].mbox_id = -1;
     slot_table[slot_id].status = EMPTY;
     slot_table[slot_id].next_slot = NULL;
 }
 
+/*
+ * Zeros a slot and puts it on the front of the free list
+ */
+void free_slot(int slot_id) {
+    zero_slot(slot_id);
+    slot_table[slot_id].next_slot = free_slot_list;
+    free_slot_list = &slot_table[slot_id];
+}
+
 /*
  * Zeros all variables of the process for the given PID parameter
  */
 void zero_mbox_proc(int pid) {
-   mbox_proc_table[pid % MAXPROC].pid = -1;
-   mbox_proc_table[pid % MAXPROC].status = EMPTY;
-   mbox_proc_table[pid % MAXPROC].message = NULL;
-   mbox_proc_table[pid % MAXPROC].msg_size = -1;
-   mbox_proc_table[pid % MAXPROC].mbox_released = 0;
-   mbox_proc_table[pid % MAXPROC].next_block_send = NULL;
-   mbox_proc_table[pid % MAXPROC].next_block_recv = NULL;
+   mbox_proc_table[pid % num_proc_slots].pid = -1;
+   mbox_proc_table[pid % num_proc_slots].status = EMPTY;
+   mbox_proc_table[pid % num_proc_slots].message = NULL;
+   mbox_proc_table[pid % num_proc_slots].msg_size = -1;
+   mbox_proc_table[pid % num_proc_slots].mbox_released = 0;
+   mbox_proc_table[pid % num_proc_slots].next_block_send = NULL;
+   mbox_proc_table[pid % num_proc_slots].next_block_recv = NULL;
+   mbox_proc_table[pid % num_proc_slots].prev_block_recv = NULL;
+   mbox_proc_table[pid % num_proc_slots].wait_any = 0;
+   mbox_proc_table[pid % num_proc_slots].mbox_id = -1;
+   mbox_proc_table[pid % num_proc_slots].wait_count = 0;
+   mbox_proc_table[pid % num_proc_slots].fired = -1;
 }
 
 /*
@@ -784,6 +1358,9 @@ void clock_handler2(int dev, long unit) {
 
     int status;
 
+    // Charge the time spent here to the interrupted process
+    interrupt_enter();
+
     clock_counter++;
     
     if (DEBUG2 && debugflag2) {
@@ -792,10 +1369,10 @@ void clock_handler2(int dev, long unit) {
 
     if (clock_counter >= 5) {
         device_input(CLOCK_DEV, 0, &status);
-        int sent = MboxCondSend(0, &status, sizeof(int));
-        
+        post_status(0, status);
+
         if (DEBUG2 && debugflag2) {
-            console("clock_handler2(): conditional message sent status was %d", sent);
+            console("clock_handler2(): posted status %d\n", status);
         }
 
         clock_counter = 0;
@@ -803,6 +1380,7 @@ void clock_handler2(int dev, long unit) {
 
     time_slice();
 
+    interrupt_exit();
     enableInterrupts();
 } /* clockHandler */
 
@@ -826,10 +1404,13 @@ void disk_handler(int dev, long unit) {
     int status;
     int mbox_id = unit + 1;
 
+    interrupt_enter();
+
     device_input(DISK_DEV, unit, &status);
 
-    MboxCondSend(mbox_id, &status, sizeof(status));
+    post_status(mbox_id, status);
 
+    interrupt_exit();
     enableInterrupts();
 } /* disk_handler */
 
@@ -853,10 +1434,13 @@ void term_handler(int dev, long unit) {
     int status;
     int mbox_id = unit + 3;
 
+    interrupt_enter();
+
     device_input(TERM_DEV, unit, &status);
 
-    MboxCondSend(mbox_id, &status, sizeof(int));
+    post_status(mbox_id, status);
 
+    interrupt_exit();
     enableInterrupts();
 } /* term_handler */
 
@@ -887,17 +1471,17 @@ void syscall_handler(int dev, void *unit) {
 } /* syscall_handler */
 
 /*
- * Returns the index of the next available slot from the slot array or -2 if
- * there is no available slot.
+ * Takes the next available slot off the free list and returns its index,
+ * or -2 if there is no available slot.
  */
 int get_slot_index() {
-    int i;
-    for (i = 0; i < MAXSLOTS; i++) {
-        if (slot_table[i].status == EMPTY) {
-           return i;
-        }
+    slot_ptr slot = free_slot_list;
+    if (slot == NULL) {
+        return -2;
     }
-    return -2;
+    free_slot_list = slot->next_slot;
+    slot->next_slot = NULL;
+    return slot->slot_id;
 }
 
 /*
@@ -906,25 +1490,309 @@ int get_slot_index() {
 slot_ptr init_slot(int slot_index, int mbox_id, void *msg_ptr, int msg_size) {
     slot_table[slot_index].mbox_id = mbox_id;
     slot_table[slot_index].status = USED;
-    memcpy(slot_table[slot_index].message, msg_ptr, msg_size);
     slot_table[slot_index].msg_size = msg_size;
+    if (msg_size > SLOT_INLINE) {
+        slot_table[slot_index].body.chunk = alloc_chunk(msg_size);
+    }
+    memcpy(slot_message(&slot_table[slot_index]), msg_ptr, msg_size);
     return &slot_table[slot_index];
 }
 
 /*
- * Adds a slot to the slot list for a mailbox
+ * Returns where the message of a slot is stored
+ */
+char *slot_message(slot_ptr slot) {
+    if (slot->msg_size <= SLOT_INLINE) {
+        return slot->body.inline_msg;
+    }
+    return slot->body.chunk;
+}
+
+/*
+ * Returns the index of the smallest chunk size class that holds size bytes
+ */
+int chunk_class(int size) {
+    int i;
+    for (i = 0; i < CHUNK_CLASSES - 1; i++) {
+        if (size <= chunk_pools[i].chunk_size) {
+            break;
+        }
+    }
+    return i;
+}
+
+/*
+ * Takes a chunk of at least size bytes from its pool, refilling the pool
+ * with CHUNKS_PER_REFILL new chunks when it is empty
+ */
+char *alloc_chunk(int size) {
+    chunk_pool *pool = &chunk_pools[chunk_class(size)];
+
+    if (pool->free_list == NULL) {
+        char *block = malloc(CHUNKS_PER_REFILL * pool->chunk_size);
+        int i;
+
+        if (block == NULL) {
+            console("alloc_chunk(): cannot allocate message storage. Halting...\n");
+            halt(1);
+        }
+        chunk_bytes += CHUNKS_PER_REFILL * pool->chunk_size;
+        for (i = 0; i < CHUNKS_PER_REFILL; i++) {
+            free_chunk(block + i * pool->chunk_size, pool->chunk_size);
+        }
+    }
+
+    char *chunk = pool->free_list;
+    pool->free_list = *(char **) chunk;
+    return chunk;
+}
+
+/*
+ * Puts a chunk that held size bytes back on the front of its pool
+ */
+void free_chunk(char *chunk, int size) {
+    chunk_pool *pool = &chunk_pools[chunk_class(size)];
+
+    *(char **) chunk = pool->free_list;
+    pool->free_list = chunk;
+}
+
+/*
+ * Puts a message into a mailbox without blocking, straight into the buffer
+ * of the first blocked receiver, else into a new slot. Returns 0, -1 if
+ * the receiver's buffer is too small, or -2 if there is no room. A process
+ * woken here is dispatched when the critical section ends.
+ */
+int put_message(mailbox_ptr mbptr, void *msg_ptr, int msg_size) {
+    if (mbptr->block_recv_list != NULL) {
+        mbox_proc_ptr receiver = pop_recv_list(mbptr);
+        if (msg_size > receiver->msg_size) {
+            receiver->status = FAILED;
+            unblock_proc(receiver->pid);
+            return -1;
+        }
+        memcpy(receiver->message, msg_ptr, msg_size);
+        receiver->msg_size = msg_size;
+        mbptr->sends++;
+        mbptr->receives++;
+        unblock_proc(receiver->pid);
+        return 0;
+    }
+
+    if (mbptr->slots_used >= mbptr->num_slots) {
+        return -2;
+    }
+    int slot = get_slot_index();
+    if (slot == -2) {
+        return -2;
+    }
+    add_slot_to_list(init_slot(slot, mbptr->mbox_id, msg_ptr, msg_size), mbptr);
+    return 0;
+}
+
+/*
+ * Takes the oldest device status waiting in the ring of an I/O mailbox.
+ * Returns its size, -1 if msg_size is too small for it, or -2 if the
+ * mailbox has none.
+ */
+int take_status(mailbox_ptr mbptr, void *msg_ptr, int msg_size) {
+    status_ring *ring;
+
+    if (mbptr->mbox_id >= IO_MBOXES || status_rings[mbptr->mbox_id].count == 0) {
+        return -2;
+    }
+    if (msg_size < (int) sizeof(int)) {
+        return -1;
+    }
+    ring = &status_rings[mbptr->mbox_id];
+    memcpy(msg_ptr, &ring->status[ring->head], sizeof(int));
+    ring->head = (ring->head + 1) % STATUS_RING;
+    ring->count--;
+    mbptr->receives++;
+    return sizeof(int);
+}
+
+/*
+ * Takes the next message out of a mailbox without blocking: a pending
+ * device status, then its first slot, or the first blocked sender of a
+ * zero-slot mailbox. A sender blocked on a full mailbox gets the freed
+ * slot. Returns the size of the message, -1 if it is bigger than
+ * msg_size, or -2 if there is none.
+ */
+int take_message(mailbox_ptr mbptr, void *msg_ptr, int msg_size) {
+    slot_ptr slot = mbptr->slot_list;
+    mbox_proc_ptr sender;
+    int size = take_status(mbptr, msg_ptr, msg_size);
+
+    if (size != -2) {
+        return size;
+    }
+
+    if (slot == NULL) {
+        sender = mbptr->block_send_list;
+        if (mbptr->num_slots != 0 || sender == NULL) {
+            return -2;
+        }
+        if (sender->msg_size > msg_size) {
+            return -1;
+        }
+        pop_send_list(mbptr);
+        memcpy(msg_ptr, sender->message, sender->msg_size);
+        mbptr->sends++;
+        mbptr->receives++;
+        unblock_proc(sender->pid);
+        return sender->msg_size;
+    }
+
+    if (slot->msg_size > msg_size) {
+        return -1;
+    }
+    size = slot->msg_size;
+    memcpy(msg_ptr, slot_message(slot), size);
+    pop_slot_list(mbptr);
+    free_slot(slot->slot_id);
+    mbptr->slots_used--;
+
+    if (mbptr->block_send_list != NULL) {
+        sender = pop_send_list(mbptr);
+        add_slot_to_list(init_slot(get_slot_index(), mbptr->mbox_id,
+                sender->message, sender->msg_size), mbptr);
+        unblock_proc(sender->pid);
+    }
+    return size;
+}
+
+/*
+ * Adds a slot to the end of the slot list for a mailbox
  */
 int add_slot_to_list(slot_ptr slot_to_add, mailbox_ptr mbptr) {
-    slot_ptr head = mbptr->slot_list;
-    if (head == NULL) {
+    slot_to_add->next_slot = NULL;
+    if (mbptr->slot_tail == NULL) {
         mbptr->slot_list = slot_to_add;
     } else {
-        while (head->next_slot != NULL) {
-            head = head->next_slot;
+        mbptr->slot_tail->next_slot = slot_to_add;
+    }
+    mbptr->slot_tail = slot_to_add;
+    mbptr->sends++;
+    if (++mbptr->slots_used > mbptr->max_depth) {
+        mbptr->max_depth = mbptr->slots_used;
+    }
+    return mbptr->slots_used;
+}
+
+/*
+ * Removes and returns the first slot on the slot list for a mailbox
+ */
+slot_ptr pop_slot_list(mailbox_ptr mbptr) {
+    slot_ptr slot = mbptr->slot_list;
+    mbptr->slot_list = slot->next_slot;
+    if (mbptr->slot_list == NULL) {
+        mbptr->slot_tail = NULL;
+    }
+    mbptr->receives++;
+    return slot;
+}
+
+/*
+ * Adds a process to the end of the block send list for a mailbox
+ */
+void add_to_send_list(mailbox_ptr mbptr, mbox_proc_ptr proc) {
+    proc->next_block_send = NULL;
+    if (mbptr->block_send_tail == NULL) {
+        mbptr->block_send_list = proc;
+    } else {
+        mbptr->block_send_tail->next_block_send = proc;
+    }
+    mbptr->block_send_tail = proc;
+}
+
+/*
+ * Removes and returns the first process on the block send list for a mailbox
+ */
+mbox_proc_ptr pop_send_list(mailbox_ptr mbptr) {
+    mbox_proc_ptr proc = mbptr->block_send_list;
+    mbptr->block_send_list = proc->next_block_send;
+    if (mbptr->block_send_list == NULL) {
+        mbptr->block_send_tail = NULL;
+    }
+    proc->next_block_send = NULL;
+    return proc;
+}
+
+/*
+ * Adds a process to the end of the block receive list for a mailbox
+ */
+void add_to_recv_list(mailbox_ptr mbptr, mbox_proc_ptr proc) {
+    proc->next_block_recv = NULL;
+    proc->prev_block_recv = mbptr->block_recv_tail;
+    if (mbptr->block_recv_tail == NULL) {
+        mbptr->block_recv_list = proc;
+    } else {
+        mbptr->block_recv_tail->next_block_recv = proc;
+    }
+    mbptr->block_recv_tail = proc;
+}
+
+/*
+ * Removes and returns the first process on the block receive list for a
+ * mailbox
+ */
+mbox_proc_ptr pop_recv_list(mailbox_ptr mbptr) {
+    mbox_proc_ptr proc = mbptr->block_recv_list;
+    mbptr->block_recv_list = proc->next_block_recv;
+    if (mbptr->block_recv_list == NULL) {
+        mbptr->block_recv_tail = NULL;
+    } else {
+        mbptr->block_recv_list->prev_block_recv = NULL;
+    }
+    proc->next_block_recv = NULL;
+    if (proc->wait_any) {
+        end_wait_any(proc);
+    }
+    return proc;
+}
+
+/*
+ * Removes a process from anywhere on the block receive list for a mailbox,
+ * in constant time since the list is doubly linked. Does nothing if the
+ * process isn't on the list.
+ */
+void remove_from_recv_list(mailbox_ptr mbptr, mbox_proc_ptr proc) {
+    if (proc->prev_block_recv == NULL && mbptr->block_recv_list != proc) {
+        return;
+    }
+    if (proc->prev_block_recv == NULL) {
+        mbptr->block_recv_list = proc->next_block_recv;
+    } else {
+        proc->prev_block_recv->next_block_recv = proc->next_block_recv;
+    }
+    if (proc->next_block_recv == NULL) {
+        mbptr->block_recv_tail = proc->prev_block_recv;
+    } else {
+        proc->next_block_recv->prev_block_recv = proc->prev_block_recv;
+    }
+    proc->next_block_recv = NULL;
+    proc->prev_block_recv = NULL;
+}
+
+/*
+ * Called when a MboxWaitAny entry is taken off a block receive list to be
+ * woken. Takes the process's other entries off their lists, so only one
+ * mailbox delivers to it, and records which entry was taken.
+ */
+void end_wait_any(mbox_proc_ptr entry) {
+    mbox_proc_ptr proc = &mbox_proc_table[entry->pid % num_proc_slots];
+    mbox_proc_ptr entries = &wait_any_table[(entry->pid % num_proc_slots) * MAX_WAIT_ANY];
+    int i;
+
+    for (i = 0; i < proc->wait_count; i++) {
+        if (&entries[i] == entry) {
+            proc->fired = i;
+        } else {
+            remove_from_recv_list(&mailbox_table[entries[i].mbox_id], &entries[i]);
         }
-        head->next_slot = slot_to_add;
     }
-    return ++mbptr->slots_used;
+    proc->wait_count = 0;
 }
 
 /*
@@ -932,6 +1800,9 @@ int add_slot_to_list(slot_ptr slot_to_add, mailbox_ptr mbptr) {
  */
 void enableInterrupts() {
     psr_set(psr_get() | PSR_CURRENT_INT);
+
+    // Leaving the critical section, switch now if a wakeup was deferred
+    resched();
 }
 
 /*
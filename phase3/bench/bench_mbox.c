@@ -0,0 +1,104 @@
+/* Measures a two stage user mode pipeline passing small records through a
+ * mailbox, one message per system call and in batches.
+ *
+ * A producer sends TOTAL sequence numbered 8 byte records to a consumer
+ * of the same priority through a BOX_SLOTS slot mailbox.
+ *
+ * single: Mbox_Send and Mbox_Receive, one record per system call
+ * batch:  Mbox_SendMany and Mbox_ReceiveMany, BURST records per call
+ *
+ * The consumer checks every record arrives in order. Prints one
+ * "key=value" line per mode and burst size, times are wall clock
+ * nanoseconds per record.
+ */
+
+#include <usyscall.h>
+#include <libuser.h>
+#include <stdio.h>
+#include <time.h>
+#include <usloss.h>
+
+#define TOTAL     20000
+#define BOX_SLOTS 64
+
+typedef struct record {
+   int seq;
+   int value;
+} record;
+
+int Producer(char *);
+int Consumer(char *);
+long now_ns(void);
+
+int box;
+int burst;
+int errors;
+
+int bursts[] = {1, 8, 32, 64};
+
+int start3(char *arg)
+{
+   int n, pid, status;
+   long start;
+
+   Mbox_Create(BOX_SLOTS, sizeof(record), &box);
+
+   for (n = 0; n < sizeof(bursts) / sizeof(bursts[0]); n++) {
+      burst = bursts[n];
+      errors = 0;
+      start = now_ns();
+      Spawn("Consumer", Consumer, NULL, USLOSS_MIN_STACK, 3, &pid);
+      Spawn("Producer", Producer, NULL, USLOSS_MIN_STACK, 3, &pid);
+      Wait(&pid, &status);
+      Wait(&pid, &status);
+      printf("bench=phase3 op=mbox mode=%s burst=%d records=%d "
+             "ns_per_record=%ld errors=%d\n", burst == 1 ? "single" : "batch",
+             burst, TOTAL, (now_ns() - start) / TOTAL, errors);
+   }
+
+   Mbox_Release(box);
+   return 0;
+} /* start3 */
+
+int Producer(char *arg)
+{
+   record records[64];
+   int seq, i;
+
+   for (seq = 0; seq < TOTAL; seq += burst) {
+      for (i = 0; i < burst; i++) {
+         records[i].seq = seq + i;
+         records[i].value = 2 * (seq + i);
+      }
+      if (burst == 1)
+         Mbox_Send(box, sizeof(record), records);
+      else
+         Mbox_SendMany(box, sizeof(record), records, burst);
+   }
+   return 0;
+} /* Producer */
+
+int Consumer(char *arg)
+{
+   record records[64];
+   int next = 0, got, i;
+
+   while (next < TOTAL) {
+      if (burst == 1)
+         got = Mbox_Receive(box, sizeof(record), records) < 0 ? 0 : 1;
+      else
+         got = Mbox_ReceiveMany(box, sizeof(record), records, burst, NULL);
+      for (i = 0; i < got; i++, next++)
+         if (records[i].seq != next || records[i].value != 2 * next)
+            errors++;
+   }
+   return 0;
+} /* Consumer */
+
+long now_ns(void)
+{
+   struct timespec ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
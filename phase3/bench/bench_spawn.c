@@ -0,0 +1,83 @@
+/* Measures the Spawn/Wait round trip from user mode.
+ *
+ * spawn_wait: Spawns a priority 4 child that returns at once, then Waits
+ *             for it, so each round trip crosses the system call boundary
+ *             twice and runs the child through spawn_launch and Terminate
+ *
+ * Prints one "key=value" line: operations per second of wall time, then
+ * p50/p90/p99/max latency in GetTimeofDay() microseconds and in wall
+ * clock nanoseconds.
+ */
+
+#include <usyscall.h>
+#include <libuser.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <usloss.h>
+
+#define ITERATIONS 2000
+
+int Child(char *);
+long now_ns(void);
+int compare_ints(const void *a, const void *b);
+int compare_longs(const void *a, const void *b);
+
+int sim_us[ITERATIONS];
+long wall_ns[ITERATIONS];
+
+int start3(char *arg)
+{
+   int i, pid, status, sim_start, sim_end;
+   long wall_start, total;
+
+   total = now_ns();
+   for (i = 0; i < ITERATIONS; i++) {
+      GetTimeofDay(&sim_start);
+      wall_start = now_ns();
+      Spawn("Child", Child, NULL, USLOSS_MIN_STACK, 4, &pid);
+      Wait(&pid, &status);
+      wall_ns[i] = now_ns() - wall_start;
+      GetTimeofDay(&sim_end);
+      sim_us[i] = sim_end - sim_start;
+   }
+   total = now_ns() - total;
+
+   qsort(sim_us, ITERATIONS, sizeof(int), compare_ints);
+   qsort(wall_ns, ITERATIONS, sizeof(long), compare_longs);
+   printf("bench=phase3 op=spawn_wait iters=%d ops_per_sec=%.0f "
+          "sim_p50_us=%d sim_p90_us=%d sim_p99_us=%d sim_max_us=%d "
+          "wall_p50_ns=%ld wall_p90_ns=%ld wall_p99_ns=%ld wall_max_ns=%ld\n",
+          ITERATIONS, ITERATIONS * 1e9 / total,
+          sim_us[ITERATIONS / 2], sim_us[ITERATIONS * 90 / 100],
+          sim_us[ITERATIONS * 99 / 100], sim_us[ITERATIONS - 1],
+          wall_ns[ITERATIONS / 2], wall_ns[ITERATIONS * 90 / 100],
+          wall_ns[ITERATIONS * 99 / 100], wall_ns[ITERATIONS - 1]);
+
+   return 0;
+} /* start3 */
+
+int Child(char *arg)
+{
+   return 0;
+} /* Child */
+
+long now_ns(void)
+{
+   struct timespec ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+int compare_ints(const void *a, const void *b)
+{
+   return *(const int *) a - *(const int *) b;
+}
+
+int compare_longs(const void *a, const void *b)
+{
+   long x = *(const long *) a, y = *(const long *) b;
+
+   return (x > y) - (x < y);
+}
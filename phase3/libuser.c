@@ -258,4 +258,290 @@ void GetPID(int *pid)
     return;
 } /* end of GetPID */
 
+/*
+ *  Routine:  GetProcUsage
+ *
+ *  Description: This is the call entry point for the CPU usage
+ *               counters of a process.
+ *
+ *  Arguments:    int pid  -- the process to report on
+ *                struct proc_usage *usage -- pointer to output value
+ *                (output value: the usage counters of the process)
+ *
+ *  Return Value: 0 means success, -1 means no such process
+ *
+ */
+int GetProcUsage(int pid, struct proc_usage *usage)
+{
+    sysargs sa;
+
+    CHECKMODE;
+    sa.number = SYS_GETPROCUSAGE;
+    sa.arg1 = (void *) pid;
+    sa.arg2 = (void *) usage;
+    usyscall(&sa);
+    return (int) sa.arg4;
+} /* end of GetProcUsage */
+
+/*
+ *  Routine:  Mbox_Create
+ *
+ *  Description: This is the call entry point to create a mailbox.
+ *
+ *  Arguments:    int numslots -- number of slots in the mailbox
+ *                int slotsize -- largest message, in bytes
+ *                int *mbox    -- pointer to output value
+ *                (output value: the mailbox id)
+ *
+ *  Return Value: 0 means success, -1 means error occurs
+ *
+ */
+int Mbox_Create(int numslots, int slotsize, int *mbox)
+{
+    sysargs sa;
+
+    CHECKMODE;
+    sa.number = SYS_MBOXCREATE;
+    sa.arg1 = (void *) numslots;
+    sa.arg2 = (void *) slotsize;
+    usyscall(&sa);
+    *mbox = (int) sa.arg1;
+    return (int) sa.arg4;
+} /* end of Mbox_Create */
+
+
+/*
+ *  Routine:  Mbox_Release
+ *
+ *  Description: This is the call entry point to release a mailbox.
+ *
+ *  Arguments:    int mbox -- the mailbox id
+ *
+ *  Return Value: 0 means success, -1 means error occurs,
+ *                -3 means the caller was zapped
+ *
+ */
+int Mbox_Release(int mbox)
+{
+    sysargs sa;
+
+    CHECKMODE;
+    sa.number = SYS_MBOXRELEASE;
+    sa.arg1 = (void *) mbox;
+    usyscall(&sa);
+    return (int) sa.arg4;
+} /* end of Mbox_Release */
+
+
+/*
+ *  Routine:  Mbox_Send
+ *
+ *  Description: This is the call entry point to send a message,
+ *               blocking while the mailbox is full.
+ *
+ *  Arguments:    int mbox  -- the mailbox id
+ *                int size  -- # of bytes in the message
+ *                void *msg -- the message
+ *
+ *  Return Value: 0 means success, -1 means error occurs,
+ *                -3 means zapped or the mailbox was released
+ *
+ */
+int Mbox_Send(int mbox, int size, void *msg)
+{
+    sysargs sa;
+
+    CHECKMODE;
+    sa.number = SYS_MBOXSEND;
+    sa.arg1 = (void *) mbox;
+    sa.arg2 = msg;
+    sa.arg3 = (void *) size;
+    usyscall(&sa);
+    return (int) sa.arg4;
+} /* end of Mbox_Send */
+
+
+/*
+ *  Routine:  Mbox_Receive
+ *
+ *  Description: This is the call entry point to receive a message,
+ *               blocking until one arrives.
+ *
+ *  Arguments:    int mbox  -- the mailbox id
+ *                int size  -- # of bytes msg can hold
+ *                void *msg -- where to put the message
+ *
+ *  Return Value: size of the message, -1 means error occurs,
+ *                -3 means zapped or the mailbox was released
+ *
+ */
+int Mbox_Receive(int mbox, int size, void *msg)
+{
+    sysargs sa;
+
+    CHECKMODE;
+    sa.number = SYS_MBOXRECEIVE;
+    sa.arg1 = (void *) mbox;
+    sa.arg2 = msg;
+    sa.arg3 = (void *) size;
+    usyscall(&sa);
+    if ((int) sa.arg4 < 0) {
+        return (int) sa.arg4;
+    }
+    return (int) sa.arg2;
+} /* end of Mbox_Receive */
+
+
+/*
+ *  Routine:  Mbox_CondSend
+ *
+ *  Description: This is the call entry point to send a message
+ *               without blocking.
+ *
+ *  Arguments:    int mbox  -- the mailbox id
+ *                int size  -- # of bytes in the message
+ *                void *msg -- the message
+ *
+ *  Return Value: 0 means success, -1 means error occurs,
+ *                -2 means the mailbox is full
+ *
+ */
+int Mbox_CondSend(int mbox, int size, void *msg)
+{
+    sysargs sa;
+
+    CHECKMODE;
+    sa.number = SYS_MBOXCONDSEND;
+    sa.arg1 = (void *) mbox;
+    sa.arg2 = msg;
+    sa.arg3 = (void *) size;
+    usyscall(&sa);
+    return (int) sa.arg4;
+} /* end of Mbox_CondSend */
+
+
+/*
+ *  Routine:  Mbox_CondReceive
+ *
+ *  Description: This is the call entry point to receive a message
+ *               without blocking.
+ *
+ *  Arguments:    int mbox  -- the mailbox id
+ *                int size  -- # of bytes msg can hold
+ *                void *msg -- where to put the message
+ *
+ *  Return Value: size of the message, -1 means error occurs,
+ *                -2 means no message is waiting
+ *
+ */
+int Mbox_CondReceive(int mbox, int size, void *msg)
+{
+    sysargs sa;
+
+    CHECKMODE;
+    sa.number = SYS_MBOXCONDRECEIVE;
+    sa.arg1 = (void *) mbox;
+    sa.arg2 = msg;
+    sa.arg3 = (void *) size;
+    usyscall(&sa);
+    if ((int) sa.arg4 < 0) {
+        return (int) sa.arg4;
+    }
+    return (int) sa.arg2;
+} /* end of Mbox_CondReceive */
+
+
+/*
+ *  Routine:  Mbox_SendMany
+ *
+ *  Description: This is the call entry point to send a batch of
+ *               messages in one system call, blocking while the
+ *               mailbox is full.
+ *
+ *  Arguments:    int mbox   -- the mailbox id
+ *                int size   -- # of bytes in each message
+ *                void *msgs -- the messages, stored back to back
+ *                int count  -- # of messages
+ *
+ *  Return Value: 0 means success, -1 means error occurs,
+ *                -3 means zapped or the mailbox was released
+ *
+ */
+int Mbox_SendMany(int mbox, int size, void *msgs, int count)
+{
+    sysargs sa;
+
+    CHECKMODE;
+    sa.number = SYS_MBOXSENDMANY;
+    sa.arg1 = (void *) mbox;
+    sa.arg2 = msgs;
+    sa.arg3 = (void *) size;
+    sa.arg4 = (void *) count;
+    usyscall(&sa);
+    return (int) sa.arg4;
+} /* end of Mbox_SendMany */
+
+
+/*
+ *  Routine:  Mbox_ReceiveMany
+ *
+ *  Description: This is the call entry point to receive a batch of
+ *               messages in one system call. Blocks until there is
+ *               one, then takes up to count - 1 more already waiting.
+ *
+ *  Arguments:    int mbox   -- the mailbox id
+ *                int size   -- # of bytes each message can hold
+ *                void *msgs -- where to put the messages, size bytes apart
+ *                int count  -- most messages to receive
+ *                int *sizes -- where to put the size of each message,
+ *                              may be NULL
+ *
+ *  Return Value: # of messages received, -1 means error occurs,
+ *                -3 means zapped or the mailbox was released
+ *
+ */
+int Mbox_ReceiveMany(int mbox, int size, void *msgs, int count, int *sizes)
+{
+    sysargs sa;
+
+    CHECKMODE;
+    sa.number = SYS_MBOXRECEIVEMANY;
+    sa.arg1 = (void *) mbox;
+    sa.arg2 = msgs;
+    sa.arg3 = (void *) size;
+    sa.arg4 = (void *) count;
+    sa.arg5 = (void *) sizes;
+    usyscall(&sa);
+    return (int) sa.arg4;
+} /* end of Mbox_ReceiveMany */
+
+
+/*
+ *  Routine:  Mbox_Stats
+ *
+ *  Description: This is the call entry point for the activity counters
+ *               of the mailboxes in use.
+ *
+ *  Arguments:    struct mbox_stats *stats -- where to put the counters
+ *                int max    -- most mailboxes to report
+ *                int *count -- pointer to output value
+ *                (output value: # of mailboxes reported)
+ *
+ *  Return Value: 0 means success, -1 means error occurs
+ *
+ */
+int Mbox_Stats(struct mbox_stats *stats, int max, int *count)
+{
+    sysargs sa;
+
+    CHECKMODE;
+    sa.number = SYS_MBOXSTATS;
+    sa.arg1 = (void *) stats;
+    sa.arg2 = (void *) max;
+    usyscall(&sa);
+    *count = (int) sa.arg1;
+    return (int) sa.arg4;
+} /* end of Mbox_Stats */
+
+
 /* end libuser.c */
@@ -21,8 +21,8 @@
 
 /* -------------------------- Globals ------------------------------------- */
 
-// Process table, phase 3 version
-proc_struct3 procTable[MAXPROC]; 
+// Process table, phase 3 version, num_proc_slots entries allocated by start2
+proc_struct3 *procTable;
 
 // Semaphore table
 sem_struct semTable[MAXSEMS]; 
@@ -44,6 +44,16 @@ void semFree(sysargs *args);
 void getPID(sysargs *args);
 void getTimeOfDay(sysargs *args);
 void cpuTime(sysargs *args);
+void getProcUsage(sysargs *args);
+void mboxCreate(sysargs *args);
+void mboxRelease(sysargs *args);
+void mboxSend(sysargs *args);
+void mboxReceive(sysargs *args);
+void mboxCondSend(sysargs *args);
+void mboxCondReceive(sysargs *args);
+void mboxSendMany(sysargs *args);
+void mboxReceiveMany(sysargs *args);
+void mboxStats(sysargs *args);
 int spawn_real(char *name, int (*func)(char *), char *arg, int stack_size, int priority);
 int wait_real(int *status);
 void nullsys3(sysargs *args);
@@ -76,8 +86,13 @@ int start2(char *arg) {
      * Data structure initialization as needed...
      */
 	 
-    // Init all structs in the process table to EMPTY
-    for (i = 0; i < MAXPROC; i++) {
+    // Allocate the process table and init all its structs to EMPTY
+    procTable = calloc(num_proc_slots, sizeof(proc_struct3));
+    if (procTable == NULL) {
+        console("start2(): cannot allocate process table. Halting...\n");
+        halt(1);
+    }
+    for (i = 0; i < num_proc_slots; i++) {
         procTable[i].status = EMPTY;
     }
 
@@ -102,6 +117,16 @@ int start2(char *arg) {
     sys_vec[SYS_GETPID] = getPID;
     sys_vec[SYS_GETTIMEOFDAY] = getTimeOfDay;
     sys_vec[SYS_CPUTIME] = cpuTime;
+    sys_vec[SYS_GETPROCUSAGE] = getProcUsage;
+    sys_vec[SYS_MBOXCREATE] = mboxCreate;
+    sys_vec[SYS_MBOXRELEASE] = mboxRelease;
+    sys_vec[SYS_MBOXSEND] = mboxSend;
+    sys_vec[SYS_MBOXRECEIVE] = mboxReceive;
+    sys_vec[SYS_MBOXCONDSEND] = mboxCondSend;
+    sys_vec[SYS_MBOXCONDRECEIVE] = mboxCondReceive;
+    sys_vec[SYS_MBOXSENDMANY] = mboxSendMany;
+    sys_vec[SYS_MBOXRECEIVEMANY] = mboxReceiveMany;
+    sys_vec[SYS_MBOXSTATS] = mboxStats;
 
     /*
      * Create first user-level process and wait for it to finish.
@@ -219,35 +244,35 @@ int spawn_real(char *name, int (* func)(char *), char *arg, int stack_size, int
     }
 
     // Check for higher priority parent, so that the parent can init the process table
-    if (procTable[child_PID % MAXPROC].status == EMPTY) {
+    if (procTable[child_PID % num_proc_slots].status == EMPTY) {
         mailbox_ID = MboxCreate(0, 0);
-        procTable[child_PID % MAXPROC].mbox_id = mailbox_ID;
-        procTable[child_PID % MAXPROC].status = ACTIVE;
+        procTable[child_PID % num_proc_slots].mbox_id = mailbox_ID;
+        procTable[child_PID % num_proc_slots].status = ACTIVE;
     } else {
-        mailbox_ID = procTable[child_PID % MAXPROC].mbox_id;
+        mailbox_ID = procTable[child_PID % num_proc_slots].mbox_id;
     }
 
     // Now we can add the child info to the process table
-    procTable[child_PID % MAXPROC].pid = child_PID;
-    strcpy(procTable[child_PID % MAXPROC].name, name);
-    procTable[child_PID % MAXPROC].priority = priority;
-    procTable[child_PID % MAXPROC].func = func;
-    procTable[child_PID % MAXPROC].child_proc_ptr = NULL;
-    procTable[child_PID % MAXPROC].next_sibling_ptr = NULL;
-    procTable[child_PID % MAXPROC].next_sem_block = NULL;
+    procTable[child_PID % num_proc_slots].pid = child_PID;
+    strcpy(procTable[child_PID % num_proc_slots].name, name);
+    procTable[child_PID % num_proc_slots].priority = priority;
+    procTable[child_PID % num_proc_slots].func = func;
+    procTable[child_PID % num_proc_slots].child_proc_ptr = NULL;
+    procTable[child_PID % num_proc_slots].next_sibling_ptr = NULL;
+    procTable[child_PID % num_proc_slots].next_sem_block = NULL;
     if (arg == NULL) {
-        procTable[child_PID % MAXPROC].start_arg[0] = 0;
+        procTable[child_PID % num_proc_slots].start_arg[0] = 0;
     } else {
-        strcpy(procTable[child_PID % MAXPROC].start_arg, arg);
+        strcpy(procTable[child_PID % num_proc_slots].start_arg, arg);
     }
-    procTable[child_PID % MAXPROC].stack_size = stack_size;
+    procTable[child_PID % num_proc_slots].stack_size = stack_size;
 
     // We don't want start2 to add its info to the process table, 
     // so verify that this PID doesn't match its PID before adding anything
     if (getpid() != START2_PID) {
         // This isn't start2, add info to table
-        procTable[child_PID % MAXPROC].parent_ptr = &procTable[getpid() % MAXPROC];
-        add_child_to_list(&procTable[child_PID % MAXPROC]);
+        procTable[child_PID % num_proc_slots].parent_ptr = &procTable[getpid() % num_proc_slots];
+        add_child_to_list(&procTable[child_PID % num_proc_slots]);
     }
 
     // Could be children that need to be awaken
@@ -270,10 +295,10 @@ int spawn_launch(char *arg) {
     int func_return_value; 
 
     // If the parent hasn't setup a process table yet, then the child will do it
-    if (procTable[pid % MAXPROC].status == EMPTY) {
-        procTable[pid % MAXPROC].status = ACTIVE;
+    if (procTable[pid % num_proc_slots].status == EMPTY) {
+        procTable[pid % num_proc_slots].status = ACTIVE;
         mailbox_ID = MboxCreate(0, 0);
-        procTable[pid % MAXPROC].mbox_id = mailbox_ID;
+        procTable[pid % num_proc_slots].mbox_id = mailbox_ID;
         MboxReceive(mailbox_ID, NULL, 0);
     }
 
@@ -286,7 +311,7 @@ int spawn_launch(char *arg) {
     set_user_mode();
 
     // Child process execution
-    func_return_value = procTable[pid % MAXPROC].func(procTable[pid % MAXPROC].start_arg);
+    func_return_value = procTable[pid % num_proc_slots].func(procTable[pid % num_proc_slots].start_arg);
     
     Terminate(func_return_value);
     
@@ -316,7 +341,7 @@ void wait(sysargs *args) {
     kid_pid = wait_real(&status);
 
     // Set status to 'ACTIVE'
-    procTable[getpid() % MAXPROC].status = ACTIVE;
+    procTable[getpid() % num_proc_slots].status = ACTIVE;
     
     if (kid_pid == -2) {
         args->arg1 = (void *) 0;
@@ -338,7 +363,7 @@ void wait(sysargs *args) {
    Side Effects - the process  will be blocked if no children have terminated
    ----------------------------------------------------------------------- */
 int wait_real(int *status) {
-    procTable[getpid() % MAXPROC].status = WAIT_BLOCK;
+    procTable[getpid() % num_proc_slots].status = WAIT_BLOCK;
     return join(status);
 }
 
@@ -355,7 +380,7 @@ int wait_real(int *status) {
    ----------------------------------------------------------------------- */
 void terminate(sysargs *args) {
     // parent = the calling process
-    proc_ptr3 parent = &procTable[getpid() % MAXPROC]; 
+    proc_ptr3 parent = &procTable[getpid() % num_proc_slots]; 
 
     // Check for children and zap them if they exist
     if (parent->child_proc_ptr != NULL) {
@@ -367,7 +392,7 @@ void terminate(sysargs *args) {
 
     // The children will call terminate when they remove themselves from the parents
     if (parent->pid != START3_PID && parent->parent_ptr != NULL) {
-        remove_from_child_list(&procTable[getpid() % MAXPROC]);
+        remove_from_child_list(&procTable[getpid() % num_proc_slots]);
     }
 
     // Change the status to EMPTY, we shouldn't be using it anymore
@@ -461,13 +486,13 @@ void semP(sysargs *args) {
     if (semaphore->count < 1) {
 
         // Add to the sem block list
-        add_to_sem_block_list(&procTable[getpid() % MAXPROC], sem_index);
+        add_to_sem_block_list(&procTable[getpid() % num_proc_slots], sem_index);
         
         // We can release the mutex
         MboxReceive(semaphore->mbox_id, NULL, 0); 
 
         // Block the process on the private mailbox
-        MboxReceive(procTable[getpid() % MAXPROC].mbox_id, NULL, 0);
+        MboxReceive(procTable[getpid() % num_proc_slots].mbox_id, NULL, 0);
 
         // Check if the mailbox was released while a process was waiting to enter
         if (semaphore->status == EMPTY) {
@@ -617,9 +642,151 @@ void getTimeOfDay(sysargs *args) {
 }
 
 
-// Returns the phase1 readtime value
+// Returns the total CPU time charged to the calling process by phase1
 void cpuTime(sysargs *args) {
-    args->arg1 = ((void *) (long) readtime());
+    proc_usage usage;
+
+    get_proc_usage(getpid(), &usage);
+    args->arg1 = ((void *) (long) usage.cpu_time);
+    set_user_mode();
+}
+
+
+/* ------------------------------------------------------------------------
+   Name - getProcUsage
+   Purpose - Reports the cumulative CPU usage of any process
+   Parameters - sysargs *args, the arguments that are passed from libuser.c
+                arg1: PID of the process to report on
+                arg2: address of the proc_usage struct to fill in
+   Returns - N/A, just sets arg values
+             arg4: -1 if the process does not exist; 0 otherwise
+   Side Effects - N/A
+   ----------------------------------------------------------------------- */
+void getProcUsage(sysargs *args) {
+    int pid = ((int) (long) args->arg1);
+    proc_usage *usage = (proc_usage *) args->arg2;
+
+    if (usage == NULL || get_proc_usage(pid, usage) < 0) {
+        args->arg4 = ((void *) (long) -1);
+    } else {
+        args->arg4 = ((void *) (long) 0);
+    }
+
+    set_user_mode();
+}
+
+
+/* ------------------------------------------------------------------------
+   Name - mboxCreate, mboxRelease, mboxSend, mboxReceive, mboxCondSend,
+          mboxCondReceive
+   Purpose - The user mode interface to the phase 2 mailboxes
+   Parameters - sysargs *args, the arguments that are passed from libuser.c
+                arg1: number of slots, or the mailbox id
+                arg2: slot size, or the message buffer
+                arg3: size of the message or buffer
+   Returns - N/A, just sets arg values
+             arg1: the id of a new mailbox
+             arg2: the size of a received message
+             arg4: the negative phase 2 result on failure; 0 otherwise
+   Side Effects - N/A
+   ----------------------------------------------------------------------- */
+void mboxCreate(sysargs *args) {
+    int mbox_id = MboxCreate((int) (long) args->arg1, (int) (long) args->arg2);
+
+    args->arg1 = ((void *) (long) mbox_id);
+    args->arg4 = ((void *) (long) (mbox_id < 0 ? -1 : 0));
+    set_user_mode();
+}
+
+void mboxRelease(sysargs *args) {
+    int result = MboxRelease((int) (long) args->arg1);
+
+    args->arg4 = ((void *) (long) result);
+    set_user_mode();
+}
+
+void mboxSend(sysargs *args) {
+    int result = MboxSend((int) (long) args->arg1, args->arg2,
+                          (int) (long) args->arg3);
+
+    args->arg4 = ((void *) (long) result);
+    set_user_mode();
+}
+
+void mboxReceive(sysargs *args) {
+    int result = MboxReceive((int) (long) args->arg1, args->arg2,
+                             (int) (long) args->arg3);
+
+    args->arg2 = ((void *) (long) result);
+    args->arg4 = ((void *) (long) (result < 0 ? result : 0));
+    set_user_mode();
+}
+
+void mboxCondSend(sysargs *args) {
+    int result = MboxCondSend((int) (long) args->arg1, args->arg2,
+                              (int) (long) args->arg3);
+
+    args->arg4 = ((void *) (long) result);
+    set_user_mode();
+}
+
+void mboxCondReceive(sysargs *args) {
+    int result = MboxCondReceive((int) (long) args->arg1, args->arg2,
+                                 (int) (long) args->arg3);
+
+    args->arg2 = ((void *) (long) result);
+    args->arg4 = ((void *) (long) (result < 0 ? result : 0));
+    set_user_mode();
+}
+
+
+/* ------------------------------------------------------------------------
+   Name - mboxSendMany, mboxReceiveMany
+   Purpose - Move a batch of messages through a mailbox in one system call
+   Parameters - sysargs *args, the arguments that are passed from libuser.c
+                arg1: the mailbox id
+                arg2: the messages, stored back to back
+                arg3: size of each message
+                arg4: number of messages
+                arg5: where to put the size of each received message
+   Returns - N/A, just sets arg values
+             arg4: the MboxSendMany or MboxReceiveMany result
+   Side Effects - N/A
+   ----------------------------------------------------------------------- */
+void mboxSendMany(sysargs *args) {
+    int result = MboxSendMany((int) (long) args->arg1, args->arg2,
+                              (int) (long) args->arg3, (int) (long) args->arg4);
+
+    args->arg4 = ((void *) (long) result);
+    set_user_mode();
+}
+
+void mboxReceiveMany(sysargs *args) {
+    int result = MboxReceiveMany((int) (long) args->arg1, args->arg2,
+                                 (int) (long) args->arg3, (int) (long) args->arg4,
+                                 (int *) args->arg5);
+
+    args->arg4 = ((void *) (long) result);
+    set_user_mode();
+}
+
+
+/* ------------------------------------------------------------------------
+   Name - mboxStats
+   Purpose - Reports the activity counters of the mailboxes in use
+   Parameters - sysargs *args, the arguments that are passed from libuser.c
+                arg1: address of the mbox_stats array to fill in
+                arg2: number of entries in the array
+   Returns - N/A, just sets arg values
+             arg1: number of mailboxes reported
+             arg4: -1 if the arguments are invalid; 0 otherwise
+   Side Effects - N/A
+   ----------------------------------------------------------------------- */
+void mboxStats(sysargs *args) {
+    int count = MboxGetStats((mbox_stats *) args->arg1, (int) (long) args->arg2);
+
+    args->arg1 = ((void *) (long) (count < 0 ? 0 : count));
+    args->arg4 = ((void *) (long) (count < 0 ? -1 : 0));
     set_user_mode();
 }
 
@@ -646,7 +813,7 @@ void nullsys3(sysargs *args) {
    Side Effects - modifies parent child list
    ----------------------------------------------------------------------- */
 void add_child_to_list(proc_ptr3 child) {
-    proc_ptr3 parent = &procTable[getpid() % MAXPROC];
+    proc_ptr3 parent = &procTable[getpid() % num_proc_slots];
     
     // If the process has no children add it to the beginning 
     if (parent->child_proc_ptr == NULL) {
@@ -32,7 +32,7 @@ typedef struct proc_struct3 {
    proc_ptr3        next_sem_block;    	// next process on semaphore block list 
    char            name[MAXNAME];    	// process name
    char            start_arg[MAXARG]; 	// function arguments
-   short           pid;              	// process ID
+   int             pid;              	// process ID
    int             priority;         	// process priority
    int (* func) (char *);				// process code
    unsigned int    stack_size;       	// stack size
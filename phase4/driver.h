@@ -12,7 +12,7 @@ typedef struct proc_struct4 {
    int             wake_time;        // time to be woken up in microseconds
    char            name[MAXNAME];    
    char            start_arg[MAXARG]; // function arguments
-   short           pid;              
+   int             pid;              
    int             priority;         
    int (* userFunc) (char *);        // code to execute
    unsigned int    stack_size;        
@@ -1,11 +1,21 @@
+#include <phase1.h>
+
+/* Record the scheduler events phase 1 reports in the trace ring */
+
 void
 p1_fork(int pid)
-{}
+{
+    trace_event(TRACE_FORK, pid, 0);
+}
 
 void
 p1_switch(int old, int new)
-{}
+{
+    trace_event(TRACE_SWITCH, new, old);
+}
 
 void
 p1_quit(int pid)
-{}
+{
+    trace_event(TRACE_QUIT, pid, 0);
+}
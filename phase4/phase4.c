@@ -42,8 +42,8 @@ void enableInterrupts();
 
 /* -------------------------- Globals ------------------------------------- */
 
-// Process Table
-proc_struct4 proc_table[MAXPROC];
+// Process Table, num_proc_slots entries allocated by start3
+proc_struct4 *proc_table;
 
 int clockSemaphore;
 int diskSemaphore[DISK_UNITS];
@@ -71,8 +71,13 @@ void start3() {
     // Check kernel mode here
     check_kernel_mode("start3");
 
-    // Empty out process table
-    for (int i = 0; i < MAXPROC; i++) {
+    // Allocate and empty out process table
+    proc_table = calloc(num_proc_slots, sizeof(proc_struct4));
+    if (proc_table == NULL) {
+        console("start3(): cannot allocate process table. Halting...\n");
+        halt(1);
+    }
+    for (int i = 0; i < num_proc_slots; i++) {
         proc_table[i].status = EMPTY;
         proc_table[i].pid = -1;
     }
@@ -97,9 +102,9 @@ void start3() {
     }
 
     // Add the clockPID to the process table
-    strcpy(proc_table[clockPID % MAXPROC].name, "Clock driver");
-    proc_table[clockPID % MAXPROC].pid = clockPID;
-    proc_table[clockPID % MAXPROC].status = ACTIVE;
+    strcpy(proc_table[clockPID % num_proc_slots].name, "Clock driver");
+    proc_table[clockPID % num_proc_slots].pid = clockPID;
+    proc_table[clockPID % num_proc_slots].status = ACTIVE;
 
     // start3 blocks until clock driver is running
     semp_real(clockSemaphore);
@@ -120,9 +125,9 @@ void start3() {
         int sector, track;
         diskSize_real(i, &sector, &track, &tracksOnDisk[i]);
 
-        strcpy(proc_table[pid % MAXPROC].name, name);
-        proc_table[pid % MAXPROC].pid = pid;
-        proc_table[pid % MAXPROC].status = ACTIVE;
+        strcpy(proc_table[pid % num_proc_slots].name, name);
+        proc_table[pid % num_proc_slots].pid = pid;
+        proc_table[pid % num_proc_slots].status = ACTIVE;
     } 
     
     pid = spawn_real("start4", start4, NULL, 4 * USLOSS_MIN_STACK, 3);
@@ -418,7 +423,7 @@ int sleep_real(int seconds) {
     addToProcessTable();
 
     // Process to add to the sleep list and block
-    proc_ptr4 toAdd = &proc_table[getpid() % MAXPROC];
+    proc_ptr4 toAdd = &proc_table[getpid() % num_proc_slots];
 
     int wake_time = sys_clock() + (1000000 * seconds);
     toAdd->wake_time = wake_time;
@@ -443,7 +448,7 @@ int sleep_real(int seconds) {
     }
 
     // Block on the private mailbox
-    MboxReceive(proc_table[getpid() % MAXPROC].mboxID, NULL, 0);
+    MboxReceive(proc_table[getpid() % num_proc_slots].mboxID, NULL, 0);
 
     // Remove from the process table
     removeFromProcessTable();
@@ -515,7 +520,7 @@ int diskRead_real(int unit, int start_track, int start_sector, int sectors, void
     info.start_sector = start_sector;
     info.sectors = sectors;
     info.disk_buf = disk_buf;
-    info.mboxID = proc_table[getpid() % MAXPROC].mboxID;
+    info.mboxID = proc_table[getpid() % num_proc_slots].mboxID;
     info.operation = DISK_READ;
     info.next = NULL;
 
@@ -524,7 +529,7 @@ int diskRead_real(int unit, int start_track, int start_sector, int sectors, void
 
     semv_real(diskSemaphore[unit]); // Wake up the driver
 
-    MboxReceive(proc_table[getpid() % MAXPROC].mboxID, NULL, 0);
+    MboxReceive(proc_table[getpid() % num_proc_slots].mboxID, NULL, 0);
     
     // Done, remove process from table
     removeFromProcessTable();
@@ -638,7 +643,7 @@ int diskWrite_real(int unit, int start_track, int start_sector, int sectors, voi
     info.start_sector = start_sector;
     info.sectors = sectors;
     info.disk_buf = disk_buf;
-    info.mboxID = proc_table[getpid() % MAXPROC].mboxID;
+    info.mboxID = proc_table[getpid() % num_proc_slots].mboxID;
     info.operation = DISK_WRITE;
     info.next = NULL;
 
@@ -647,7 +652,7 @@ int diskWrite_real(int unit, int start_track, int start_sector, int sectors, voi
 
     semv_real(diskSemaphore[unit]);
 
-    MboxReceive(proc_table[getpid() % MAXPROC].mboxID, NULL, 0);
+    MboxReceive(proc_table[getpid() % num_proc_slots].mboxID, NULL, 0);
     
     // Done, remove the process from the table
     removeFromProcessTable();
@@ -751,11 +756,11 @@ void check_kernel_mode(char * process_name) {
     Adds a process to the proc_table and creates a mailbox for it
    ------------------------------------------------------------------- */
 void addToProcessTable() {
-    if (getpid() !=  proc_table[getpid() % MAXPROC].pid) {
-        proc_table[getpid() % MAXPROC].pid = getpid();
-        proc_table[getpid() % MAXPROC].status = ACTIVE;
-        proc_table[getpid() % MAXPROC].mboxID = MboxCreate(0,0);
-        proc_table[getpid() % MAXPROC].sleep_ptr = NULL;
+    if (getpid() !=  proc_table[getpid() % num_proc_slots].pid) {
+        proc_table[getpid() % num_proc_slots].pid = getpid();
+        proc_table[getpid() % num_proc_slots].status = ACTIVE;
+        proc_table[getpid() % num_proc_slots].mboxID = MboxCreate(0,0);
+        proc_table[getpid() % num_proc_slots].sleep_ptr = NULL;
     }
 }
 
@@ -765,11 +770,11 @@ void addToProcessTable() {
     mailbox.
    ------------------------------------------------------------------ */
 void removeFromProcessTable() {
-    MboxRelease(proc_table[getpid() % MAXPROC].mboxID);
-    proc_table[getpid() % MAXPROC].pid = -1;
-    proc_table[getpid() % MAXPROC].status = EMPTY;
-    proc_table[getpid() % MAXPROC].mboxID = -1;
-    proc_table[getpid() % MAXPROC].sleep_ptr = NULL;
+    MboxRelease(proc_table[getpid() % num_proc_slots].mboxID);
+    proc_table[getpid() % num_proc_slots].pid = -1;
+    proc_table[getpid() % num_proc_slots].status = EMPTY;
+    proc_table[getpid() % num_proc_slots].mboxID = -1;
+    proc_table[getpid() % num_proc_slots].sleep_ptr = NULL;
 }
 
 
@@ -5,6 +5,9 @@
 #ifndef _LIBUSER_H
 #define _LIBUSER_H
 
+struct proc_usage;
+struct mbox_stats;
+
 /* Phase 3 -- User Function Prototypes */
 extern int  Spawn(char *name, int (*func)(char *), char *arg, int stack_size,
                   int priority, int *pid);
@@ -13,6 +16,7 @@ extern void Terminate(int status);
 extern void GetTimeofDay(int *tod);
 extern void CPUTime(int *cpu);
 extern void GetPID(int *pid);
+extern int  GetProcUsage(int pid, struct proc_usage *usage);
 extern int  SemCreate(int value, int *semaphore);
 extern int  SemP(int semaphore);
 extern int  SemV(int semaphore);
@@ -35,6 +39,10 @@ extern int  Mbox_Send(int mbox, int size, void *msg);
 extern int  Mbox_Receive(int mbox, int size, void *msg);
 extern int  Mbox_CondSend(int mbox, int size, void *msg);
 extern int  Mbox_CondReceive(int mbox, int size, void *msg);
+extern int  Mbox_SendMany(int mbox, int size, void *msgs, int count);
+extern int  Mbox_ReceiveMany(int mbox, int size, void *msgs, int count,
+                             int *sizes);
+extern int  Mbox_Stats(struct mbox_stats *stats, int max, int *count);
 
 /* Phase 5 -- User Function Prototypes */
 extern void *VmInit(int mappings, int pages, int frames, int pagers);
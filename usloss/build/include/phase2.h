@@ -13,6 +13,7 @@
 #define MAXMBOX         2000 /* 500 */
 #define MAXSLOTS        2500 /* 5000 */
 #define MAX_MESSAGE     150  /* largest possible message in a single slot */
+#define MAX_WAIT_ANY    8    /* most mailboxes one MboxWaitAny waits on */
 
 /* returns id of mailbox, or -1 if no more mailboxes, -2 if invalid args */
 extern int MboxCreate(int slots, int slot_size);
@@ -32,6 +33,67 @@ extern int MboxCondSend(int mbox_id, void *msg_ptr, int msg_size);
 /* returns 0 if successful, 1 if no msg available, -1 if illegal args */
 extern int MboxCondReceive(int mbox_id, void *msg_ptr, int msg_max_size);
 
+/*
+ * Mailboxes that pass messages by reference. The receiver gets the
+ * sender's buffer itself, no matter its size, and owns it from then on.
+ * Buffers must come from malloc, those still queued when the mailbox is
+ * released are freed with it.
+ */
+
+/* returns id of mailbox, or -1 if no more mailboxes or invalid args */
+extern int MboxCreateRef(int slots);
+
+/* returns 0 if successful, -1 if invalid args */
+extern int MboxSendRef(int mbox_id, void *buffer, int size);
+
+/* returns size of the buffer stored in *buffer if successful, -1 if invalid args */
+extern int MboxReceiveRef(int mbox_id, void **buffer);
+
+/*
+ * Batches of messages, each one a single critical section. The messages
+ * are stored back to back, msg_size (or msg_max_size) bytes apart.
+ */
+
+/* sends count msgs, blocking while the mailbox is full;
+ * returns 0 if successful, -1 if invalid args, -3 if zapped or released */
+extern int MboxSendMany(int mbox_id, void *msg_ptr, int msg_size, int count);
+
+/* blocks for one msg, then takes up to count - 1 more already waiting;
+ * stores each msg size in sizes[] unless it is NULL;
+ * returns # of msgs received, -1 if invalid args, -3 if zapped or released */
+extern int MboxReceiveMany(int mbox_id, void *msg_ptr, int msg_max_size,
+                           int count, int *sizes);
+
+/* blocks until one of the count mailboxes in mbox_ids has a msg, and
+ * receives it, the first of them in mbox_ids order if several do; stores
+ * the id of that mailbox in *mbox_id;
+ * returns size of received msg, -1 if invalid args, -3 if zapped or that
+ * mailbox was released */
+extern int MboxWaitAny(int *mbox_ids, int count, void *msg_ptr,
+                       int msg_max_size, int *mbox_id);
+
+/*
+ * Activity counters of a mailbox since it was created, times are in
+ * microseconds of sys_clock()
+ */
+typedef struct mbox_stats {
+        int     mbox_id;
+        int     num_slots;
+        int     slots_used;
+        int     sends;              /* msgs put in, by any kind of send */
+        int     receives;           /* msgs taken out */
+        int     cond_failures;      /* MboxCondSend/Receive that would block */
+        int     blocked_sends;      /* times a sender blocked on it */
+        int     blocked_receives;   /* times a receiver blocked on it */
+        int     blocked_time;       /* time processes spent blocked on it */
+        int     max_depth;          /* most slots in use at once */
+        int     overflows;          /* device statuses dropped, I/O boxes */
+} mbox_stats;
+
+/* copies the counters of up to max mailboxes in use into stats;
+ * returns # of mailboxes copied, -1 if invalid args */
+extern int MboxGetStats(mbox_stats *stats, int max);
+
 /* type = interrupt device type, unit = # of device (when more than one),
  * status = where interrupt handler puts device's status register.
  */
@@ -13,6 +13,14 @@
 
 #define MAXPROC		50
 
+/*
+ * Number of process table slots, set at startup to MAXPROC or to the
+ * PHASE1_MAXPROC environment variable if that is larger. A process
+ * uses slot pid % num_proc_slots of each phase's table.
+ */
+
+extern int num_proc_slots;
+
 /*
  * Maximum length of a process name
  */
@@ -36,6 +44,57 @@
 /* the lowest priority a process can have */
 #define LOWEST_PRIORITY 6
 
+/*
+ * Cumulative CPU usage of a process, times are in microseconds of sys_clock()
+ */
+
+typedef struct proc_usage {
+	int	cpu_time;	/* time spent running */
+	int	ready_time;	/* time spent waiting to run */
+	int	blocked_time;	/* time spent blocked */
+	int	int_time;	/* part of cpu_time spent in interrupt handlers */
+	int	vol_switches;	/* switched out after blocking, quitting or a handoff */
+	int	invol_switches;	/* preempted while still runnable */
+} proc_usage;
+
+/*
+ * A FIFO of processes blocked waiting for the same event
+ */
+
+typedef struct wait_queue {
+	struct proc_struct	*head;
+	struct proc_struct	*tail;
+} wait_queue;
+
+/*
+ * Scheduler trace events, recorded with trace_event() when the
+ * PHASE1_TRACE environment variable names a trace file
+ */
+
+#define TRACE_FORK	0
+#define TRACE_SWITCH	1
+#define TRACE_BLOCK	2
+#define TRACE_UNBLOCK	3
+#define TRACE_QUIT	4
+#define TRACE_INTERRUPT	5
+
+/*
+ * Scheduling policies, chosen at startup with the PHASE1_SCHED environment
+ * variable: "priority" (the default) runs the highest priority ready
+ * process, "stride" shares the CPU in proportion to SCHED_TICKETS, and
+ * "mlfq" sinks processes that use up their time slice and raises those
+ * woken from I/O
+ */
+
+#define SCHED_PRIORITY	0
+#define SCHED_STRIDE	1
+#define SCHED_MLFQ	2
+
+/* Priority 1 gets 16 tickets, each lower priority half as many */
+#define SCHED_TICKETS(priority)	(32 >> (priority))
+
+extern int sched_policy;
+
 /* 
  * Function prototypes for this phase.
  */
@@ -50,8 +109,21 @@ extern	int		getpid(void);
 extern	void		dump_processes(void);
 extern  int             block_me(int block_status);
 extern  int             unblock_proc(int pid);
+extern  int             handoff_proc(int pid);
+extern  void            wait_queue_init(wait_queue *queue);
+extern  int             wait_queue_wait(wait_queue *queue, int block_status);
+extern  int             wait_queue_wake_one(wait_queue *queue);
+extern  int             wait_queue_wake_all(wait_queue *queue);
+extern  void            resched(void);
+extern  void            trace_event(int type, int pid, int arg);
 extern  int             read_cur_start_time(void);
+extern  void            read_switch_counts(int *switches, int *no_switches);
+extern  int             get_proc_usage(int pid, proc_usage *usage);
+extern  void            interrupt_enter(void);
+extern  void            interrupt_exit(void);
 extern  void            time_slice(void);
+extern  int             set_time_slice(int priority, int slice);
+extern  void            set_tickless(int on);
 extern  void            dispatcher(void);
 extern	int		readtime(void);
 
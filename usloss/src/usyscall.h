@@ -26,6 +26,7 @@
 #define SYS_GETTIMEOFDAY	20
 #define SYS_CPUTIME		21
 #define SYS_GETPID		22
+#define SYS_GETPROCUSAGE	23
 
 #ifdef PHASE_3
 #define SYS_VMINIT		24
@@ -37,9 +38,14 @@
 #define SYS_COW			30
 #endif
 
+// Batched mailbox calls, numbered past the phase 5 range above
+#define SYS_MBOXSENDMANY	31
+#define SYS_MBOXRECEIVEMANY	32
+#define SYS_MBOXSTATS		33
+
 // Leave some room for growth
 
-#define USLOSS_MAX_SYSCALLS	30	
+#define USLOSS_MAX_SYSCALLS	40	
 
 
 /*  The USLOSS_Sysargs structure */